@@ -0,0 +1,581 @@
+
+#include "bundle.h"
+#include <errno.h> 			/* errno */
+#include <stdio.h> 			/* fopen(), fwrite(), fprintf(), perror() */
+#include <stdlib.h> 		/* realloc(), calloc(), free(), realpath() */
+#include <string.h> 		/* memset(), strlen(), strcmp() */
+#include <linux/limits.h> 	/* PATH_MAX */
+
+/* Open-addressed hash index over one of the arrays of a bundle. Each slot
+ * keeps the hash of its key, so that the index can grow without looking at
+ * the keys again, and the position of the entry plus one, 0 marking an empty
+ * slot. */
+
+typedef struct {
+	uint32_t hash;
+	uint32_t entry;
+} Slot;
+
+struct IgniBundleIndex {
+	Slot* slots;
+	uint32_t cap;
+	uint32_t count;
+};
+
+typedef int (*MatchFn)(
+	const IgniRndBundle* bundle,
+	uint32_t entry,
+	const void* key
+);
+
+void igniRndBundleInit(IgniRndBundle* bundle)
+{
+	memset(bundle, 0, sizeof(*bundle));
+}
+
+void igniRndBundleFree(IgniRndBundle* bundle)
+{
+	free(bundle->textures);
+	free(bundle->meshes);
+	free(bundle->pointLights);
+	free(bundle->strings);
+
+	struct IgniBundleIndex* indices[] = {
+		bundle->meshIndex,
+		bundle->pointLightIndex,
+		bundle->pathIndex
+	};
+
+	for (size_t i = 0; i < sizeof(indices) / sizeof(*indices); ++i) {
+		if (indices[i]) {
+			free(indices[i]->slots);
+			free(indices[i]);
+		}
+	}
+
+	igniRndBundleInit(bundle);
+}
+
+/* Grow an array so that it can hold at least one more element. */
+static int reserve(void** arr, uint32_t count, uint32_t* cap, size_t elemSz)
+{
+	if (count < *cap) {
+		return 0;
+	}
+
+	uint32_t newCap = *cap ? *cap * 2 : 64;
+	void* newArr = realloc(*arr, newCap * elemSz);
+
+	if (!newArr) {
+		perror("realloc() in libigni bundle writer failed");
+		return -1;
+	}
+
+	*arr = newArr;
+	*cap = newCap;
+	return 0;
+}
+
+static uint32_t fnv1a(const void* data, size_t len)
+{
+	const uint8_t* bytes = data;
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/* Make room in an index for one more key, creating it on first use. The
+ * index is kept at most half full so that probe sequences stay short. */
+static int indexReserve(struct IgniBundleIndex** indexPtr)
+{
+	struct IgniBundleIndex* index = *indexPtr;
+
+	if (!index) {
+		index = calloc(1, sizeof(*index));
+		if (!index) {
+			perror("calloc() in libigni bundle writer failed");
+			return -1;
+		}
+
+		*indexPtr = index;
+	}
+
+	if ((index->count + 1) * 2 <= index->cap) {
+		return 0;
+	}
+
+	uint32_t newCap = index->cap ? index->cap * 2 : 64;
+	Slot* newSlots = calloc(newCap, sizeof(Slot));
+
+	if (!newSlots) {
+		perror("calloc() in libigni bundle writer failed");
+		return -1;
+	}
+
+	for (uint32_t i = 0; i < index->cap; ++i) {
+		Slot* slot = &index->slots[i];
+		if (!slot->entry) {
+			continue;
+		}
+
+		uint32_t pos = slot->hash & (newCap - 1);
+		while (newSlots[pos].entry) {
+			pos = (pos + 1) & (newCap - 1);
+		}
+
+		newSlots[pos] = *slot;
+	}
+
+	free(index->slots);
+	index->slots = newSlots;
+	index->cap = newCap;
+	return 0;
+}
+
+/* Find the slot holding a key, or the empty slot it would be placed in.
+ * Returns NULL if nothing has been indexed yet. */
+static Slot* indexFind(
+	const struct IgniBundleIndex* index,
+	const IgniRndBundle* bundle,
+	uint32_t hash,
+	MatchFn match,
+	const void* key
+)
+{
+	if (!index || !index->cap) {
+		return NULL;
+	}
+
+	uint32_t mask = index->cap - 1;
+
+	for (uint32_t pos = hash & mask;; pos = (pos + 1) & mask) {
+		Slot* slot = &index->slots[pos];
+
+		if (
+			!slot->entry ||
+			(slot->hash == hash && match(bundle, slot->entry - 1, key))
+		) {
+			return slot;
+		}
+	}
+}
+
+/* Point a key at an entry, replacing any earlier entry with the same key so
+ * that lookups find the most recently recorded element. */
+static int indexInsert(
+	struct IgniBundleIndex** indexPtr,
+	const IgniRndBundle* bundle,
+	uint32_t hash,
+	MatchFn match,
+	const void* key,
+	uint32_t entry
+)
+{
+	if (indexReserve(indexPtr) == -1) {
+		return -1;
+	}
+
+	Slot* slot = indexFind(*indexPtr, bundle, hash, match, key);
+	if (!slot->entry) {
+		++(*indexPtr)->count;
+	}
+
+	slot->hash = hash;
+	slot->entry = entry + 1;
+	return 0;
+}
+
+static int matchPath(
+	const IgniRndBundle* bundle,
+	uint32_t entry,
+	const void* key
+)
+{
+	return !strcmp(bundle->strings + entry, key);
+}
+
+static int matchMesh(
+	const IgniRndBundle* bundle,
+	uint32_t entry,
+	const void* key
+)
+{
+	return bundle->meshes[entry].meshId == *(const IgniRndElementId*)key;
+}
+
+static int matchPointLight(
+	const IgniRndBundle* bundle,
+	uint32_t entry,
+	const void* key
+)
+{
+	return bundle->pointLights[entry].pointLightId ==
+		*(const IgniRndElementId*)key;
+}
+
+/* Resolve a path and place it in the string table, returning its offset.
+ * Scenes tend to reuse a handful of assets many times over, so paths that
+ * are already present are shared rather than stored again. */
+static int64_t addPath(IgniRndBundle* bundle, const char* path)
+{
+	char absPath[PATH_MAX];
+
+	if (!realpath(path, absPath)) {
+		perror("realpath() in libigni bundle writer failed");
+		return -1;
+	}
+
+	size_t len = strlen(absPath) + 1;
+	uint32_t hash = fnv1a(absPath, len - 1);
+
+	Slot* slot = indexFind(bundle->pathIndex, bundle, hash, matchPath, absPath);
+	if (slot && slot->entry) {
+		return slot->entry - 1;
+	}
+
+	while (bundle->stringsSz + len > bundle->stringsCap) {
+		uint32_t newCap = bundle->stringsCap ? bundle->stringsCap * 2 : 4096;
+		char* newStrings = realloc(bundle->strings, newCap);
+
+		if (!newStrings) {
+			perror("realloc() in libigni bundle writer failed");
+			return -1;
+		}
+
+		bundle->strings = newStrings;
+		bundle->stringsCap = newCap;
+	}
+
+	uint32_t offset = bundle->stringsSz;
+	memcpy(bundle->strings + offset, absPath, len);
+
+	if (indexInsert(
+		&bundle->pathIndex,
+		bundle,
+		hash,
+		matchPath,
+		absPath,
+		offset
+	) == -1) {
+		return -1;
+	}
+
+	bundle->stringsSz += len;
+	return offset;
+}
+
+static IgniBundleMesh* findMesh(IgniRndBundle* bundle, IgniRndElementId id)
+{
+	Slot* slot = indexFind(
+		bundle->meshIndex,
+		bundle,
+		fnv1a(&id, sizeof(id)),
+		matchMesh,
+		&id
+	);
+
+	if (!slot || !slot->entry) {
+		fprintf(stderr, "Mesh %u has not been recorded in bundle.\n", id);
+		errno = ENOENT;
+		return NULL;
+	}
+
+	return &bundle->meshes[slot->entry - 1];
+}
+
+static IgniBundlePointLight* findPointLight(
+	IgniRndBundle* bundle,
+	IgniRndElementId id
+)
+{
+	Slot* slot = indexFind(
+		bundle->pointLightIndex,
+		bundle,
+		fnv1a(&id, sizeof(id)),
+		matchPointLight,
+		&id
+	);
+
+	if (!slot || !slot->entry) {
+		fprintf(
+			stderr,
+			"Point light %u has not been recorded in bundle.\n",
+			id
+		);
+		errno = ENOENT;
+		return NULL;
+	}
+
+	return &bundle->pointLights[slot->entry - 1];
+}
+
+int igniRndBundleTextureCreate(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	const char* path
+)
+{
+	if (reserve(
+		(void**)&bundle->textures,
+		bundle->textureCount,
+		&bundle->textureCap,
+		sizeof(IgniBundleTexture)
+	) == -1) {
+		return -1;
+	}
+
+	int64_t pathOffset = addPath(bundle, path);
+	if (pathOffset == -1) {
+		return -1;
+	}
+
+	IgniBundleTexture* tex = &bundle->textures[bundle->textureCount++];
+	tex->textureId = id;
+	tex->pathOffset = pathOffset;
+
+	return 0;
+}
+
+int igniRndBundleMeshCreate(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	const char* path
+)
+{
+	if (reserve(
+		(void**)&bundle->meshes,
+		bundle->meshCount,
+		&bundle->meshCap,
+		sizeof(IgniBundleMesh)
+	) == -1) {
+		return -1;
+	}
+
+	int64_t pathOffset = addPath(bundle, path);
+	if (pathOffset == -1) {
+		return -1;
+	}
+
+	if (indexInsert(
+		&bundle->meshIndex,
+		bundle,
+		fnv1a(&id, sizeof(id)),
+		matchMesh,
+		&id,
+		bundle->meshCount
+	) == -1) {
+		return -1;
+	}
+
+	IgniBundleMesh* mesh = &bundle->meshes[bundle->meshCount++];
+	memset(mesh, 0, sizeof(*mesh));
+	mesh->meshId = id;
+	mesh->pathOffset = pathOffset;
+	mesh->textureId = IGNI_RENDER_NULL_ELEMENT;
+
+	return 0;
+}
+
+int igniRndBundleMeshSetShader(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	IgniRndShader shader
+)
+{
+	IgniBundleMesh* mesh = findMesh(bundle, id);
+	if (!mesh) {
+		return -1;
+	}
+
+	mesh->shader = shader;
+	mesh->flags |= IGNI_BUNDLE_HAS_SHADER;
+
+	return 0;
+}
+
+int igniRndBundleMeshBindTexture(
+	IgniRndBundle* bundle,
+	IgniRndElementId meshId,
+	IgniRndElementId texId,
+	IgniRndTextureTarget target
+)
+{
+	IgniBundleMesh* mesh = findMesh(bundle, meshId);
+	if (!mesh) {
+		return -1;
+	}
+
+	mesh->textureId = texId;
+	mesh->target = target;
+	mesh->flags |= IGNI_BUNDLE_HAS_TEXTURE;
+
+	return 0;
+}
+
+int igniRndBundleMeshTransform(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	IgniTransform tf
+)
+{
+	IgniBundleMesh* mesh = findMesh(bundle, id);
+	if (!mesh) {
+		return -1;
+	}
+
+	mesh->xLoc = tf.location.x;
+	mesh->yLoc = tf.location.y;
+	mesh->zLoc = tf.location.z;
+
+	mesh->xRot = tf.rotation.x;
+	mesh->yRot = tf.rotation.y;
+	mesh->zRot = tf.rotation.z;
+
+	mesh->xScale = tf.scale.x;
+	mesh->yScale = tf.scale.y;
+	mesh->zScale = tf.scale.z;
+
+	mesh->flags |= IGNI_BUNDLE_HAS_TRANSFORM;
+
+	return 0;
+}
+
+int igniRndBundlePointLightCreate(
+	IgniRndBundle* bundle,
+	IgniRndElementId id
+)
+{
+	if (reserve(
+		(void**)&bundle->pointLights,
+		bundle->pointLightCount,
+		&bundle->pointLightCap,
+		sizeof(IgniBundlePointLight)
+	) == -1) {
+		return -1;
+	}
+
+	if (indexInsert(
+		&bundle->pointLightIndex,
+		bundle,
+		fnv1a(&id, sizeof(id)),
+		matchPointLight,
+		&id,
+		bundle->pointLightCount
+	) == -1) {
+		return -1;
+	}
+
+	IgniBundlePointLight* light;
+	light = &bundle->pointLights[bundle->pointLightCount++];
+	memset(light, 0, sizeof(*light));
+	light->pointLightId = id;
+
+	return 0;
+}
+
+int igniRndBundlePointLightTransform(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	IgniVec3 tf
+)
+{
+	IgniBundlePointLight* light = findPointLight(bundle, id);
+	if (!light) {
+		return -1;
+	}
+
+	light->xLoc = tf.x;
+	light->yLoc = tf.y;
+	light->zLoc = tf.z;
+	light->flags |= IGNI_BUNDLE_HAS_TRANSFORM;
+
+	return 0;
+}
+
+int igniRndBundlePointLightSetColour(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	IgniVec3 colour
+)
+{
+	IgniBundlePointLight* light = findPointLight(bundle, id);
+	if (!light) {
+		return -1;
+	}
+
+	light->r = colour.r;
+	light->g = colour.g;
+	light->b = colour.b;
+	light->flags |= IGNI_BUNDLE_HAS_COLOUR;
+
+	return 0;
+}
+
+int igniRndBundleWrite(
+	const IgniRndBundle* bundle,
+	const char* path
+)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		perror("fopen() in igniRndBundleWrite() failed");
+		return -1;
+	}
+
+	/* The string table is padded so that the file size stays a multiple of
+	 * four, which keeps appended bundles aligned as well. */
+
+	uint32_t stringTableSz = (bundle->stringsSz + 3) & ~3u;
+	static const char padding[4] = {};
+
+	IgniBundleHeader header = {};
+	header.magic = IGNI_BUNDLE_MAGIC;
+	header.version = IGNI_BUNDLE_VERSION;
+	header.textureCount = bundle->textureCount;
+	header.meshCount = bundle->meshCount;
+	header.pointLightCount = bundle->pointLightCount;
+	header.stringTableSz = stringTableSz;
+
+	if (
+		fwrite(&header, sizeof(header), 1, file) != 1 ||
+		fwrite(
+			bundle->textures,
+			sizeof(IgniBundleTexture),
+			bundle->textureCount,
+			file
+		) != bundle->textureCount ||
+		fwrite(
+			bundle->meshes,
+			sizeof(IgniBundleMesh),
+			bundle->meshCount,
+			file
+		) != bundle->meshCount ||
+		fwrite(
+			bundle->pointLights,
+			sizeof(IgniBundlePointLight),
+			bundle->pointLightCount,
+			file
+		) != bundle->pointLightCount ||
+		fwrite(bundle->strings, 1, bundle->stringsSz, file)
+			!= bundle->stringsSz ||
+		fwrite(padding, 1, stringTableSz - bundle->stringsSz, file)
+			!= stringTableSz - bundle->stringsSz
+	) {
+		perror("fwrite() in igniRndBundleWrite() failed");
+		fclose(file);
+		return -1;
+	}
+
+	if (fclose(file) == EOF) {
+		perror("fclose() in igniRndBundleWrite() failed");
+		return -1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,265 @@
+#ifndef _LIBIGNI_BUNDLE_H
+#define _LIBIGNI_BUNDLE_H 1
+
+///
+/// @brief Scene bundle file signature ("IGNB")
+///
+#define IGNI_BUNDLE_MAGIC 0x424e4749
+
+///
+/// @brief Major version of the scene bundle format
+///
+#define IGNI_BUNDLE_VERSION 0
+
+#include "render.h"
+#include "types.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* A bundle file is laid out as follows, with every section starting on a
+ * four byte boundary so that a mapped file can be read in place:
+ *
+ * IgniBundleHeader
+ * IgniBundleTexture[textureCount]
+ * IgniBundleMesh[meshCount]
+ * IgniBundlePointLight[pointLightCount]
+ * char stringTable[stringTableSz]
+ *
+ * Paths are stored once in the string table as null-terminated strings and
+ * are referred to by their byte offset from the start of the table. */
+
+///
+/// @brief Flags marking which optional fields of a record are set
+///
+typedef uint8_t IgniBundleFlags;
+enum {
+	IGNI_BUNDLE_HAS_SHADER = 1 << 0,
+	IGNI_BUNDLE_HAS_TEXTURE = 1 << 1,
+	IGNI_BUNDLE_HAS_TRANSFORM = 1 << 2,
+	IGNI_BUNDLE_HAS_COLOUR = 1 << 3
+};
+
+///
+/// @brief Bundle file header
+///
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t textureCount;
+	uint32_t meshCount;
+	uint32_t pointLightCount;
+	uint32_t stringTableSz;
+}__attribute__((packed)) IgniBundleHeader;
+
+///
+/// @brief Texture loaded from file
+///
+typedef struct {
+	IgniRndElementId textureId;
+	uint32_t pathOffset;
+}__attribute__((packed)) IgniBundleTexture;
+
+///
+/// @brief Mesh loaded from file, with its shader, texture and transform
+///
+typedef struct {
+	IgniRndElementId meshId;
+	uint32_t pathOffset;
+	IgniRndElementId textureId;
+	IgniRndShader shader;
+	IgniRndTextureTarget target;
+	IgniBundleFlags flags;
+	uint8_t reserved;
+	float xLoc, yLoc, zLoc;
+	float xRot, yRot, zRot;
+	float xScale, yScale, zScale;
+}__attribute__((packed)) IgniBundleMesh;
+
+///
+/// @brief Point light with its location and colour
+///
+typedef struct {
+	IgniRndElementId pointLightId;
+	IgniBundleFlags flags;
+	uint8_t reserved[3];
+	float xLoc, yLoc, zLoc;
+	float r, g, b;
+}__attribute__((packed)) IgniBundlePointLight;
+
+///
+/// @brief Scene bundle under construction
+///
+/// \note
+/// - Initialise with igniRndBundleInit() and release with igniRndBundleFree().
+/// - Fields are managed by the igniRndBundle*() functions and should be
+///   treated as read-only.
+///
+typedef struct {
+	IgniBundleTexture* textures;
+	uint32_t textureCount;
+	uint32_t textureCap;
+
+	IgniBundleMesh* meshes;
+	uint32_t meshCount;
+	uint32_t meshCap;
+
+	IgniBundlePointLight* pointLights;
+	uint32_t pointLightCount;
+	uint32_t pointLightCap;
+
+	char* strings;
+	uint32_t stringsSz;
+	uint32_t stringsCap;
+
+	/* Hash indices over the mesh IDs, point light IDs and paths above */
+	struct IgniBundleIndex* meshIndex;
+	struct IgniBundleIndex* pointLightIndex;
+	struct IgniBundleIndex* pathIndex;
+} IgniRndBundle;
+
+///
+/// @brief Prepare an empty scene bundle
+///
+/// @param bundle 	Bundle to initialise
+///
+void igniRndBundleInit(IgniRndBundle* bundle);
+
+///
+/// @brief Release memory held by a scene bundle
+///
+/// @param bundle 	Bundle to release
+///
+void igniRndBundleFree(IgniRndBundle* bundle);
+
+///
+/// @brief Record texture loaded from file
+///
+/// @param bundle 	Bundle to record into
+/// @param id 		Texture identification number
+/// @param path 	Relative or absolute image pathname
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndBundleTextureCreate(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	const char* path
+);
+
+///
+/// @brief Record mesh loaded from file
+///
+/// @param bundle 	Bundle to record into
+/// @param id 		Mesh identification number
+/// @param path 	Relative or absolute mesh pathname
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndBundleMeshCreate(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	const char* path
+);
+
+///
+/// @brief Record mode of shading applied to a previously recorded mesh
+///
+/// @param bundle 	Bundle to record into
+/// @param id 		Mesh identification number
+/// @param shader 	Shader type to apply
+/// @return 0 upon success. -1 with errno set to ENOENT if the mesh was not
+///         recorded.
+///
+int igniRndBundleMeshSetShader(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	IgniRndShader shader
+);
+
+///
+/// @brief Record texture applied to a previously recorded mesh
+///
+/// @param bundle 	Bundle to record into
+/// @param meshId 	Mesh identification number
+/// @param texId 	Texture identification number
+/// @param target 	G-buffer which the texture affects
+/// @return 0 upon success. -1 with errno set to ENOENT if the mesh was not
+///         recorded.
+///
+int igniRndBundleMeshBindTexture(
+	IgniRndBundle* bundle,
+	IgniRndElementId meshId,
+	IgniRndElementId texId,
+	IgniRndTextureTarget target
+);
+
+///
+/// @brief Record location, rotation and scale of a previously recorded mesh
+///
+/// @param bundle 	Bundle to record into
+/// @param id 		Mesh identification number
+/// @param tf 		Transformation of mesh
+/// @return 0 upon success. -1 with errno set to ENOENT if the mesh was not
+///         recorded.
+///
+int igniRndBundleMeshTransform(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	IgniTransform tf
+);
+
+///
+/// @brief Record point light
+///
+/// @param bundle 	Bundle to record into
+/// @param id 		Point light identification number
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndBundlePointLightCreate(
+	IgniRndBundle* bundle,
+	IgniRndElementId id
+);
+
+///
+/// @brief Record location of a previously recorded point light
+///
+/// @param bundle 	Bundle to record into
+/// @param id 		Point light identification number
+/// @param tf 		Location of point light
+/// @return 0 upon success. -1 with errno set to ENOENT if the point light
+///         was not recorded.
+///
+int igniRndBundlePointLightTransform(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	IgniVec3 tf
+);
+
+///
+/// @brief Record colour of a previously recorded point light
+///
+/// @param bundle 	Bundle to record into
+/// @param id 		Point light identification number
+/// @param colour 	Colour of point light
+/// @return 0 upon success. -1 with errno set to ENOENT if the point light
+///         was not recorded.
+///
+int igniRndBundlePointLightSetColour(
+	IgniRndBundle* bundle,
+	IgniRndElementId id,
+	IgniVec3 colour
+);
+
+///
+/// @brief Write scene bundle to file
+///
+/// @param bundle 	Bundle to write
+/// @param path 	Destination pathname
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndBundleWrite(
+	const IgniRndBundle* bundle,
+	const char* path
+);
+
+#endif
+
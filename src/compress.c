@@ -0,0 +1,135 @@
+#include "internal.h"
+#include <stdint.h>
+#include <string.h> 		/* memcpy() */
+
+/* Compressed command streams use the LZ4 block format, so servers can
+ * decompress them with any LZ4 implementation. Only the compressor lives
+ * here: the library never receives compressed data.
+ *
+ * This is a plain greedy compressor with a single-entry hash table. It
+ * trades ratio for speed, which suits command streams: most of their
+ * redundancy is repeated opcodes, IDs and float prefixes a few bytes
+ * apart. */
+
+#define HASH_BITS 12
+
+/* The format requires the last 5 bytes to be literals and the last match
+ * to start at least 12 bytes before the end of the input. */
+#define LAST_LITERALS 5
+#define MF_LIMIT 12
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+
+static uint32_t read32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32_t hash4(uint32_t v)
+{
+	return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Write a length continuation as used for long literal runs and matches. */
+static uint8_t* writeLen(uint8_t* op, size_t len)
+{
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+
+	*op++ = len;
+	return op;
+}
+
+size_t igniCompress(
+	const uint8_t* src,
+	size_t len,
+	uint8_t* dst,
+	size_t dstCap
+)
+{
+	if (len < MF_LIMIT + 1) {
+		return 0;
+	}
+
+	uint32_t table[1 << HASH_BITS] = {};
+
+	const uint8_t* anchor = src;
+	const uint8_t* ip = src + 1;
+	const uint8_t* mfLimit = src + len - MF_LIMIT;
+	const uint8_t* matchLimit = src + len - LAST_LITERALS;
+
+	uint8_t* op = dst;
+	uint8_t* opEnd = dst + dstCap;
+
+	while (ip < mfLimit) {
+		uint32_t seq = read32(ip);
+		uint32_t h = hash4(seq);
+		const uint8_t* ref = src + table[h];
+		table[h] = ip - src;
+
+		if (ip - ref > MAX_OFFSET || read32(ref) != seq) {
+			++ip;
+			continue;
+		}
+
+		size_t matchLen = MIN_MATCH;
+		while (ip + matchLen < matchLimit && ref[matchLen] == ip[matchLen]) {
+			++matchLen;
+		}
+
+		size_t litLen = ip - anchor;
+
+		/* Token, literal run, offset and both length continuations */
+		size_t seqSz = 1 + litLen / 255 + 1 + litLen + 2 + matchLen / 255 + 1;
+		if (seqSz > (size_t)(opEnd - op)) {
+			return 0;
+		}
+
+		uint8_t* token = op++;
+		size_t matchCode = matchLen - MIN_MATCH;
+
+		*token = (litLen < 15 ? litLen : 15) << 4;
+		if (litLen >= 15) {
+			op = writeLen(op, litLen - 15);
+		}
+
+		memcpy(op, anchor, litLen);
+		op += litLen;
+
+		uint16_t offset = ip - ref;
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+
+		*token |= matchCode < 15 ? matchCode : 15;
+		if (matchCode >= 15) {
+			op = writeLen(op, matchCode - 15);
+		}
+
+		ip += matchLen;
+		anchor = ip;
+	}
+
+	size_t litLen = src + len - anchor;
+
+	if (1 + litLen / 255 + 1 + litLen > (size_t)(opEnd - op)) {
+		return 0;
+	}
+
+	uint8_t* token = op++;
+
+	*token = (litLen < 15 ? litLen : 15) << 4;
+	if (litLen >= 15) {
+		op = writeLen(op, litLen - 15);
+	}
+
+	memcpy(op, anchor, litLen);
+	op += litLen;
+
+	return op - dst;
+}
+
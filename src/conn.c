@@ -0,0 +1,1672 @@
+#define _GNU_SOURCE 			/* sendmmsg(), recvmmsg() */
+
+#include "conn.h"
+#include "internal.h"
+#include "group.h"
+#include "render.h"
+#include "hit.h"
+#include <stdio.h> 			/* printf(), perror() */
+#include <stdlib.h> 		/* calloc(), realloc(), free() */
+#include <string.h> 		/* memcpy(), memset(), strlen(), strncmp() */
+#include <errno.h> 			/* errno */
+#include <fcntl.h> 			/* fcntl() */
+#include <unistd.h> 		/* close() */
+#include <sched.h> 			/* sched_yield() */
+#include <sys/socket.h> 	/* socket(), connect(), send(), sendmmsg() */
+#include <sys/un.h> 		/* sockaddr_un */
+#include <netdb.h> 			/* getaddrinfo() */
+#include <netinet/in.h> 	/* IPPROTO_TCP */
+#include <netinet/tcp.h> 	/* TCP_NODELAY, TCP_CORK */
+#include <sys/uio.h> 		/* iovec */
+#include <sys/epoll.h> 		/* EPOLLOUT */
+
+/* Number of slots probed when looking up a merge key. Keys that cannot be
+ * placed within this distance are simply not merged. */
+#define MERGE_PROBES 8
+
+/* Unsubmitted bytes at which an io_uring connection submits a write
+ * without waiting to be flushed */
+#define URING_SUBMIT_SZ 16384
+
+/* Prefix of endpoints reached over TCP rather than a UNIX domain socket */
+#define TCP_PREFIX "tcp://"
+
+/* Prefix of UNIX domain socket endpoints which carry commands in frames */
+#define SEQPACKET_PREFIX "seqpacket://"
+
+#define FRAME_HDR_SZ sizeof(IgniConnFrameHeader)
+
+/* Frames passed to the kernel by one sendmmsg() call, and received by one
+ * recvmmsg() call */
+#define SEND_FRAMES 64
+#define RECV_FRAMES 8
+
+_Static_assert(
+	(int)IGNI_RENDER_OP_COMPRESSED == (int)IGNI_HIT_OP_COMPRESSED,
+	"Compressed blocks are framed identically in both protocols"
+);
+_Static_assert(
+	sizeof(IgniRndCmdCompressed) == sizeof(IgniHitCmdCompressed),
+	"Compressed blocks are framed identically in both protocols"
+);
+
+typedef struct {
+	IgniConnMergeKey key;
+	uint64_t pos;
+} MergeSlot;
+
+typedef struct {
+	IgniConnFlags flags;
+
+	/* The outbound queue is a ring of queueCap bytes, a power of two.
+	 * 'head' and 'tail' count every byte ever queued and dequeued, so their
+	 * difference is the queued byte count and neither needs wrapping. */
+	uint8_t* queue;
+	size_t queueCap;
+	uint64_t head;
+	uint64_t tail;
+
+	/* Queue position of the latest transform for each merge key. A slot is
+	 * only usable while its command is entirely unsent. */
+	MergeSlot* merge;
+	size_t mergeCap;
+
+	/* A transform must not be merged across a later command for the same
+	 * element, such as a deletion, or the two would be reordered. Unmergeable
+	 * commands record their queue position here, hashed by the element ID
+	 * that follows their opcode. Batches, and commands that may name several
+	 * elements, raise 'mergeFloor' for every element at once. A hash
+	 * collision merely costs a merge. */
+	uint64_t* barriers;
+	uint64_t mergeFloor;
+
+	/* TCP connections are corked for the length of a batch. */
+	int tcp;
+	int batchDepth;
+
+	/* Commands of a batch are collected here when compression is on. */
+	int compress;
+	uint8_t* batch;
+	size_t batchSz;
+	size_t batchCap;
+
+	/* Connections using io_uring have at most one write in flight. It
+	 * covers 'inflight' bytes from 'tail', which must not be merged into.
+	 * 'written' holds its result until the kernel is done with the queue.
+	 * A failed write is reported by the next igniConnFlush(). */
+	int uring;
+	int bufIndex;
+	size_t inflight;
+	int32_t written;
+	int writeError;
+
+	int recvDone;
+	int32_t recvResult;
+
+	/* SOCK_SEQPACKET connections send and receive frames. Queued and
+	 * batched frames keep their headers; 'frameStart' is the offset of the
+	 * batch frame being filled. Received frames are stripped of their
+	 * headers and handed out from 'rx'. */
+	int seqpacket;
+	size_t frameStart;
+
+	/* Descriptor table of the protocol spoken, which frame headers count
+	 * commands by. Without it, each igniConnSend() counts as one. */
+	const IgniOpcodeDesc* opcodes;
+
+	uint8_t* rx;
+	size_t rxPos;
+	size_t rxLen;
+} Conn;
+
+/* Connection state is looked up by file descriptor so that the existing
+ * command functions keep working on plain descriptors. */
+static Conn** conns;
+static size_t connsSz;
+
+static Conn* getConn(int fd)
+{
+	if (fd < 0 || (size_t)fd >= connsSz) {
+		return NULL;
+	}
+
+	return conns[fd];
+}
+
+static Conn* newConn(int fd);
+static void freeConn(int fd);
+
+static int connectUnix(const char* path, int type)
+{
+	struct sockaddr_un svAddr = {};
+	svAddr.sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(svAddr.sun_path)) {
+		printf("Server socket path '%s' is too long.\n", path);
+		return -1;
+	}
+	strcpy(svAddr.sun_path, path);
+
+	int fd = socket(AF_UNIX, type, 0);
+	if (fd == -1) {
+		perror("socket() in igniConnConnect() failed");
+		return -1;
+	}
+
+	/* A descriptor closed without igniConnClose() leaves its state
+	 * behind for whichever socket gets the number next. */
+	freeConn(fd);
+
+	if (connect(fd, (struct sockaddr*)&svAddr, sizeof(svAddr)) == -1) {
+		close(fd);
+
+		/* Servers choose the framing by the type of their socket. Those
+		 * listening on a stream turn seqpacket clients away. */
+		if (type == SOCK_SEQPACKET && errno == EPROTOTYPE) {
+			return connectUnix(path, SOCK_STREAM);
+		}
+
+		perror("Failed to connect to server");
+		return -1;
+	}
+
+	if (type == SOCK_SEQPACKET) {
+		Conn* conn = newConn(fd);
+		if (!conn) {
+			close(fd);
+			return -1;
+		}
+
+		conn->seqpacket = 1;
+	}
+
+	return fd;
+}
+
+static int connectTcp(const char* hostPort)
+{
+	/* Split "host:port" or "[v6 address]:port". */
+
+	char host[256];
+	const char* port = strrchr(hostPort, ':');
+	size_t hostLen = port ? (size_t)(port - hostPort) : 0;
+
+	if (hostLen && hostPort[0] == '[' && hostPort[hostLen - 1] == ']') {
+		++hostPort;
+		hostLen -= 2;
+	}
+
+	if (!port || !hostLen || hostLen >= sizeof(host)) {
+		printf("Server address '%s' is not of the form host:port.\n", hostPort);
+		return -1;
+	}
+
+	memcpy(host, hostPort, hostLen);
+	host[hostLen] = '\0';
+
+	struct addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	struct addrinfo* addrs;
+	int gaiResult = getaddrinfo(host, port + 1, &hints, &addrs);
+
+	if (gaiResult) {
+		printf("Could not resolve '%s': %s\n", host, gai_strerror(gaiResult));
+		return -1;
+	}
+
+	int fd = -1;
+
+	for (struct addrinfo* addr = addrs; addr; addr = addr->ai_next) {
+		fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+		if (fd == -1) {
+			continue;
+		}
+
+		freeConn(fd);
+
+		if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+			break;
+		}
+
+		close(fd);
+		fd = -1;
+	}
+
+	freeaddrinfo(addrs);
+
+	if (fd == -1) {
+		perror("Failed to connect to server");
+		return -1;
+	}
+
+	/* Commands are small and latency matters, so nothing should wait for
+	 * more data. Batches are coalesced with TCP_CORK instead. */
+
+	int one = 1;
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == -1) {
+		perror("setsockopt() in igniConnConnect() failed");
+	}
+
+	Conn* conn = newConn(fd);
+	if (!conn) {
+		close(fd);
+		return -1;
+	}
+
+	conn->tcp = 1;
+	return fd;
+}
+
+int igniConnConnect(const char* endpoint)
+{
+	if (!strncmp(endpoint, TCP_PREFIX, strlen(TCP_PREFIX))) {
+		return connectTcp(endpoint + strlen(TCP_PREFIX));
+	}
+
+	if (!strncmp(endpoint, SEQPACKET_PREFIX, strlen(SEQPACKET_PREFIX))) {
+		return connectUnix(endpoint + strlen(SEQPACKET_PREFIX), SOCK_SEQPACKET);
+	}
+
+	/* Anything else is the path of a UNIX domain socket. */
+
+	return connectUnix(endpoint, SOCK_STREAM);
+}
+
+static size_t roundPow2(size_t n)
+{
+	size_t p = 1;
+	while (p < n) {
+		p <<= 1;
+	}
+
+	return p;
+}
+
+/* Get the state of a connection, creating it if it has none yet. */
+static Conn* newConn(int fd)
+{
+	if (getConn(fd)) {
+		return getConn(fd);
+	}
+
+	if ((size_t)fd >= connsSz) {
+		size_t newSz = roundPow2(fd + 1);
+		Conn** newConns = realloc(conns, newSz * sizeof(*conns));
+
+		if (!newConns) {
+			perror("realloc() in libigni connection setup failed");
+			return NULL;
+		}
+
+		memset(newConns + connsSz, 0, (newSz - connsSz) * sizeof(*conns));
+		conns = newConns;
+		connsSz = newSz;
+	}
+
+	Conn* conn = calloc(1, sizeof(Conn));
+	if (!conn) {
+		perror("calloc() in libigni connection setup failed");
+		return NULL;
+	}
+
+	conns[fd] = conn;
+	return conn;
+}
+
+void igniConnSetOpcodes(int fd, const IgniOpcodeDesc* opcodes)
+{
+	/* Plain stream connections have no state yet, but need the table once
+	 * they are made non-blocking, to tell what elements a command names. */
+	Conn* conn = newConn(fd);
+
+	if (conn) {
+		conn->opcodes = opcodes;
+	}
+}
+
+int igniConnSetNonBlocking(
+	int fd,
+	size_t queueSz,
+	IgniConnFlags flags
+)
+{
+	if (fd < 0) {
+		errno = EBADF;
+		return -1;
+	}
+
+	if (igniGroupIs(fd)) {
+		return igniGroupSetNonBlocking(fd, queueSz, flags);
+	}
+
+	Conn* conn = newConn(fd);
+	if (!conn) {
+		return -1;
+	}
+
+	conn->flags = flags & ~IGNI_CONN_IO_URING;
+
+	if (conn->queue) {
+		return 0;
+	}
+
+	int fdFlags = fcntl(fd, F_GETFL);
+	if (fdFlags == -1 || fcntl(fd, F_SETFL, fdFlags | O_NONBLOCK) == -1) {
+		perror("fcntl() in igniConnSetNonBlocking() failed");
+		return -1;
+	}
+
+	conn->queueCap = roundPow2(queueSz ? queueSz : 1);
+	conn->queue = malloc(conn->queueCap);
+
+	/* One slot per 64 queued bytes comfortably covers a queue full of
+	 * transforms, which are the only mergeable commands. */
+	conn->mergeCap = roundPow2(conn->queueCap / 64 + MERGE_PROBES);
+	conn->merge = calloc(conn->mergeCap, sizeof(MergeSlot));
+	conn->barriers = calloc(conn->mergeCap, sizeof(uint64_t));
+
+	if (!conn->queue || !conn->merge || !conn->barriers) {
+		perror("malloc() in igniConnSetNonBlocking() failed");
+		free(conn->queue);
+		free(conn->merge);
+		free(conn->barriers);
+		conn->queue = NULL;
+		conn->merge = NULL;
+		conn->barriers = NULL;
+		return -1;
+	}
+
+	/* Without io_uring, the connection simply keeps using send(). Frames
+	 * go out through sendmmsg(), which io_uring has no counterpart for. */
+
+	if (
+		flags & IGNI_CONN_IO_URING &&
+		!conn->seqpacket &&
+		igniUringSetup() == 0
+	) {
+		conn->uring = 1;
+		conn->bufIndex = -1;
+
+		/* Registered buffers are written by zero-copy sends, which only
+		 * TCP sockets take. */
+		if (conn->tcp) {
+			conn->bufIndex = igniUringRegister(conn->queue, conn->queueCap);
+		}
+	}
+
+	return 0;
+}
+
+/* Copy bytes into the ring at a given queue position. */
+static void ringWrite(Conn* conn, uint64_t pos, const void* buf, size_t len)
+{
+	size_t off = pos & (conn->queueCap - 1);
+	size_t first = conn->queueCap - off;
+
+	if (first > len) {
+		first = len;
+	}
+
+	memcpy(conn->queue + off, buf, first);
+	memcpy(conn->queue, (const uint8_t*)buf + first, len - first);
+}
+
+/* Describe len queued bytes from a given queue position, which may wrap
+ * around the end of the ring. Returns the number of vectors used. */
+static int ringIov(Conn* conn, uint64_t pos, size_t len, struct iovec* iov)
+{
+	size_t off = pos & (conn->queueCap - 1);
+	size_t first = conn->queueCap - off;
+
+	iov[0].iov_base = conn->queue + off;
+	iov[0].iov_len = first < len ? first : len;
+
+	if (first >= len) {
+		return 1;
+	}
+
+	iov[1].iov_base = conn->queue;
+	iov[1].iov_len = len - first;
+	return 2;
+}
+
+static void ringRead(Conn* conn, uint64_t pos, void* buf, size_t len)
+{
+	struct iovec iov[2];
+	int iovCount = ringIov(conn, pos, len, iov);
+
+	memcpy(buf, iov[0].iov_base, iov[0].iov_len);
+
+	if (iovCount == 2) {
+		memcpy((uint8_t*)buf + iov[0].iov_len, iov[1].iov_base, iov[1].iov_len);
+	}
+}
+
+/* Find the merge slot for a key, or the slot a key should be placed in.
+ * Returns NULL if the probe window is full of live entries. */
+static MergeSlot* findMergeSlot(Conn* conn, IgniConnMergeKey key)
+{
+	size_t mask = conn->mergeCap - 1;
+	size_t i = (key * 0x9e3779b97f4a7c15ull) >> 32;
+	uint64_t unsent = conn->tail + conn->inflight;
+	MergeSlot* freeSlot = NULL;
+
+	for (int probe = 0; probe < MERGE_PROBES; ++probe) {
+		MergeSlot* slot = &conn->merge[(i + probe) & mask];
+
+		if (slot->key == key) {
+			return slot;
+		}
+
+		if (!freeSlot && (!slot->key || slot->pos < unsent)) {
+			freeSlot = slot;
+		}
+
+		if (!slot->key) {
+			break;
+		}
+	}
+
+	return freeSlot;
+}
+
+static uint64_t* findBarrier(Conn* conn, uint32_t id)
+{
+	size_t i = (id * 0x9e3779b97f4a7c15ull) >> 32;
+	return &conn->barriers[i & (conn->mergeCap - 1)];
+}
+
+/* Whether a buffer holds a single command naming at most the element
+ * after its opcode. Tails of records, unlike the bytes of a path or of
+ * pixels, stand for further elements. */
+static int namesOneElement(Conn* conn, const uint8_t* buf, size_t len)
+{
+	if (!conn->opcodes || buf[0] == IGNI_RENDER_OP_COMPRESSED) {
+		return 0;
+	}
+
+	const IgniOpcodeDesc* desc = &conn->opcodes[buf[0]];
+
+	return
+		igniOpcodeSz(conn->opcodes, buf, len) == len &&
+		!(desc->countSz && desc->elemSz > 1);
+}
+
+/* Record that an unmergeable command is about to be queued at the head.
+ * Commands that may name several elements hold back all of them. */
+static void raiseBarrier(Conn* conn, const void* buf, size_t len)
+{
+	uint32_t id;
+
+	if (!(conn->flags & IGNI_CONN_MERGE_TRANSFORMS)) {
+		return;
+	}
+
+	if (len < 1 + sizeof(id) || !namesOneElement(conn, buf, len)) {
+		conn->mergeFloor = conn->head;
+		return;
+	}
+
+	memcpy(&id, (const uint8_t*)buf + 1, sizeof(id));
+	*findBarrier(conn, id) = conn->head;
+}
+
+/* Whether the command of a merge slot may still be overwritten in place */
+static int canMerge(Conn* conn, const MergeSlot* slot)
+{
+	return
+		slot->pos >= conn->tail + conn->inflight &&
+		slot->pos >= conn->mergeFloor &&
+		slot->pos >= *findBarrier(conn, (uint32_t)slot->key);
+}
+
+/* Collect the finished io_uring operations of every connection. */
+static void reap(void)
+{
+	uint64_t data;
+	int32_t res;
+	unsigned flags;
+
+	while (igniUringReap(&data, &res, &flags)) {
+		Conn* conn = getConn(IGNI_URING_FD(data));
+
+		if (!conn || !conn->uring) {
+			continue;
+		}
+
+		switch (IGNI_URING_OP(data)) {
+		case IGNI_URING_WRITE:
+			/* A zero-copy send completes twice, and the queue is only
+			 * free to reuse after the second. */
+			if (!(flags & IGNI_URING_NOTIF)) {
+				conn->written = res;
+			}
+
+			if (flags & IGNI_URING_MORE) {
+				break;
+			}
+
+			conn->inflight = 0;
+			res = conn->written;
+
+			if (res > 0) {
+				conn->tail += res;
+			} else if (res != -EAGAIN && res != -EINTR && res != -ECANCELED) {
+				conn->writeError = -res;
+			}
+			break;
+
+		case IGNI_URING_RECV:
+			conn->recvResult = res;
+			conn->recvDone = 1;
+			break;
+		}
+	}
+}
+
+/* Hand queued bytes to io_uring unless a write is already in flight. Only
+ * contiguous bytes are written at once, so a wrapped queue takes two. */
+static void startWrite(Conn* conn, int fd)
+{
+	if (conn->inflight || conn->head == conn->tail) {
+		return;
+	}
+
+	size_t queued = conn->head - conn->tail;
+	size_t off = conn->tail & (conn->queueCap - 1);
+	size_t len = conn->queueCap - off;
+
+	if (len > queued) {
+		len = queued;
+	}
+
+	if (igniUringWrite(
+		fd,
+		conn->queue + off,
+		len,
+		conn->bufIndex,
+		IGNI_URING_DATA(fd, IGNI_URING_WRITE)
+	) == 0) {
+		conn->inflight = len;
+	}
+}
+
+/* Move an io_uring connection along without waiting for anything. */
+static int kick(Conn* conn, int fd)
+{
+	reap();
+	startWrite(conn, fd);
+
+	if (igniUringSubmit(0) == -1) {
+		/* The entries stay queued and go with the next submission. */
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+			return -1;
+		}
+	}
+
+	/* Socket writes often complete during submission already. */
+	reap();
+	return 0;
+}
+
+/* Wait for at least one completion and collect it. Fails only when the
+ * ring cannot be entered for other than passing reasons. */
+static int await(void)
+{
+	if (
+		igniUringSubmit(1) == -1 &&
+		errno != EINTR &&
+		errno != EAGAIN &&
+		errno != EBUSY
+	) {
+		return -1;
+	}
+
+	reap();
+	return 0;
+}
+
+/* The kernel must be done with the outbound queue before it is freed.
+ * Returns -1 if the ring fails while a write may still be in flight. */
+static int cancelWrite(Conn* conn, int fd)
+{
+	uint64_t data = IGNI_URING_DATA(fd, IGNI_URING_WRITE);
+
+	reap();
+
+	if (!conn->inflight) {
+		return 0;
+	}
+
+	if (igniUringDiscard(data)) {
+		conn->inflight = 0;
+		return 0;
+	}
+
+	int cancelled = 0;
+
+	while (conn->inflight) {
+		if (!cancelled) {
+			cancelled = igniUringCancel(data) == 0;
+		}
+
+		if (await() == -1) {
+			perror("io_uring_enter() in igniConnClose() failed");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* The kernel must be done with the buffer of a receive before the caller
+ * gets it back. The buffer is not ours to leak, so this keeps waiting
+ * however the ring fails. */
+static void cancelRecv(Conn* conn, int fd)
+{
+	uint64_t data = IGNI_URING_DATA(fd, IGNI_URING_RECV);
+
+	reap();
+
+	if (!conn->recvDone && igniUringDiscard(data)) {
+		conn->recvResult = -ECANCELED;
+		conn->recvDone = 1;
+	}
+
+	int cancelled = 0;
+
+	while (!conn->recvDone) {
+		if (!cancelled) {
+			cancelled = igniUringCancel(data) == 0;
+		}
+
+		if (await() == -1) {
+			sched_yield();
+		}
+	}
+}
+
+/* Send whole queued frames, as many at a time as sendmmsg() takes. */
+static ssize_t flushFrames(Conn* conn, int fd)
+{
+	while (conn->head != conn->tail) {
+		struct mmsghdr msgs[SEND_FRAMES] = {};
+		struct iovec iovs[SEND_FRAMES][2];
+		size_t frameSz[SEND_FRAMES];
+
+		unsigned count = 0;
+		uint64_t pos = conn->tail;
+
+		while (count < SEND_FRAMES && pos != conn->head) {
+			IgniConnFrameHeader hdr;
+			ringRead(conn, pos, &hdr, sizeof(hdr));
+
+			frameSz[count] = FRAME_HDR_SZ + hdr.len;
+
+			struct msghdr* msg = &msgs[count].msg_hdr;
+			msg->msg_iov = iovs[count];
+			msg->msg_iovlen = ringIov(conn, pos, frameSz[count], iovs[count]);
+
+			pos += frameSz[count++];
+		}
+
+		int sent = sendmmsg(fd, msgs, count, MSG_DONTWAIT);
+
+		if (sent == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+
+			return -1;
+		}
+
+		for (int i = 0; i < sent; ++i) {
+			conn->tail += frameSz[i];
+		}
+	}
+
+	return conn->head - conn->tail;
+}
+
+ssize_t igniConnFlush(int fd)
+{
+	if (igniGroupIs(fd)) {
+		return igniGroupFlush(fd);
+	}
+
+	Conn* conn = getConn(fd);
+	if (!conn || !conn->queue) {
+		return 0;
+	}
+
+	if (conn->uring) {
+		if (kick(conn, fd) == -1) {
+			return -1;
+		}
+
+		if (conn->writeError) {
+			errno = conn->writeError;
+			conn->writeError = 0;
+			return -1;
+		}
+
+		return conn->head - conn->tail;
+	}
+
+	if (conn->seqpacket) {
+		return flushFrames(conn, fd);
+	}
+
+	while (conn->head != conn->tail) {
+		struct iovec iov[2];
+
+		struct msghdr msg = {};
+		msg.msg_iov = iov;
+		msg.msg_iovlen = ringIov(conn, conn->tail, conn->head - conn->tail, iov);
+
+		ssize_t sent = sendmsg(fd, &msg, MSG_DONTWAIT);
+
+		if (sent == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+
+			return -1;
+		}
+
+		conn->tail += sent;
+	}
+
+	return conn->head - conn->tail;
+}
+
+size_t igniConnPending(int fd)
+{
+	if (igniGroupIs(fd)) {
+		return igniGroupPending(fd);
+	}
+
+	Conn* conn = getConn(fd);
+	return conn ? conn->head - conn->tail : 0;
+}
+
+int igniConnHasRoom(
+	int fd,
+	size_t len,
+	size_t count
+)
+{
+	Conn* conn = getConn(fd);
+
+	if (!conn || !conn->queue) {
+		return 1;
+	}
+
+	/* Commands collected into a batch are only queued when it ends, and a
+	 * batch kept by a failed igniConnEnd() holds up everything else. */
+	if (conn->batchDepth && (conn->compress || conn->seqpacket)) {
+		return 1;
+	}
+
+	if (conn->batchSz) {
+		return 0;
+	}
+
+	if (conn->uring) {
+		reap();
+	}
+
+	size_t hdrSz = conn->seqpacket ? FRAME_HDR_SZ : 0;
+	return conn->queueCap - (conn->head - conn->tail) >= len + count * hdrSz;
+}
+
+uint32_t igniConnEvents(int fd)
+{
+	return igniConnPending(fd) ? EPOLLOUT : 0;
+}
+
+/* Release the state of a connection, if it has any. */
+static void freeConn(int fd)
+{
+	Conn* conn = getConn(fd);
+
+	if (!conn) {
+		return;
+	}
+
+	/* A queue the kernel may still be writing from is left behind. */
+	if (!conn->uring) {
+		free(conn->queue);
+	} else if (cancelWrite(conn, fd) == 0) {
+		igniUringUnregister(conn->bufIndex);
+		free(conn->queue);
+	}
+
+	free(conn->merge);
+	free(conn->barriers);
+	free(conn->batch);
+	free(conn->rx);
+	free(conn);
+	conns[fd] = NULL;
+}
+
+int igniConnClose(int fd)
+{
+	if (igniGroupIs(fd)) {
+		return igniGroupClose(fd);
+	}
+
+	freeConn(fd);
+	return close(fd);
+}
+
+/* Send a command on a connection without state, retrying until every byte
+ * has been written so that a short write cannot split a command. */
+static int sendAll(int fd, const uint8_t* buf, size_t len)
+{
+	while (len) {
+		ssize_t sent = send(fd, buf, len, 0);
+
+		if (sent == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return -1;
+		}
+
+		buf += sent;
+		len -= sent;
+	}
+
+	return 0;
+}
+
+/* Count the commands in a buffer of whole commands */
+static uint32_t countCommands(const Conn* conn, const void* buf, size_t len)
+{
+	if (!conn->opcodes) {
+		return 1;
+	}
+
+	const uint8_t* src = buf;
+	uint32_t count = 0;
+
+	for (size_t off = 0; off < len; ++count) {
+		size_t cmdSz = igniOpcodeSz(conn->opcodes, src + off, len - off);
+
+		/* Whatever cannot be sized is passed on as a single command. */
+		if (!cmdSz || cmdSz > len - off) {
+			return count + 1;
+		}
+
+		off += cmdSz;
+	}
+
+	return count;
+}
+
+/* Send 'count' commands in a frame of their own. Datagrams are never
+ * partly sent. */
+static int sendFrame(
+	int fd,
+	const void* buf,
+	size_t len,
+	uint32_t count,
+	int flags
+)
+{
+	IgniConnFrameHeader hdr;
+	hdr.len = len;
+	hdr.count = count;
+
+	struct iovec iov[2];
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = (void*)buf;
+	iov[1].iov_len = len;
+
+	struct msghdr msg = {};
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+
+	ssize_t sent;
+
+	do {
+		sent = sendmsg(fd, &msg, flags);
+	} while (sent == -1 && errno == EINTR);
+
+	return sent == -1 ? -1 : 0;
+}
+
+/* Send a command on a connection with state, queuing what the socket does
+ * not accept if the connection is non-blocking. */
+static int deliver(
+	Conn* conn,
+	int fd,
+	const void* buf,
+	size_t len,
+	IgniConnMergeKey key
+)
+{
+	size_t hdrSz = conn->seqpacket ? FRAME_HDR_SZ : 0;
+	uint32_t count = 0;
+
+	if (conn->seqpacket) {
+		if (len > IGNI_CONN_FRAME_MAX) {
+			errno = EMSGSIZE;
+			return -1;
+		}
+
+		count = countCommands(conn, buf, len);
+	}
+
+	if (!conn->queue) {
+		return hdrSz ?
+			sendFrame(fd, buf, len, count, 0) :
+			sendAll(fd, buf, len);
+	}
+
+	if (hdrSz + len > conn->queueCap) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	/* Finished writes free up queue space and merge slots. */
+	if (conn->uring) {
+		reap();
+	}
+
+	MergeSlot* slot = NULL;
+
+	if (key != IGNI_CONN_NO_MERGE && conn->flags & IGNI_CONN_MERGE_TRANSFORMS) {
+		slot = findMergeSlot(conn, key);
+
+		if (slot && slot->key == key && canMerge(conn, slot)) {
+			ringWrite(conn, slot->pos, buf, len);
+			return 0;
+		}
+	}
+
+	/* Older bytes have to reach the socket first, so only write directly
+	 * when nothing is queued. io_uring always writes from the queue, which
+	 * is where its registered buffer lies. */
+
+	if (conn->head == conn->tail && conn->seqpacket) {
+		if (sendFrame(fd, buf, len, count, MSG_DONTWAIT) == 0) {
+			return 0;
+		}
+
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			return -1;
+		}
+	} else if (conn->head == conn->tail && !conn->uring) {
+		ssize_t sent;
+
+		do {
+			sent = send(fd, buf, len, MSG_DONTWAIT);
+		} while (sent == -1 && errno == EINTR);
+
+		if (sent == -1) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				return -1;
+			}
+
+			sent = 0;
+		}
+
+		if ((size_t)sent == len) {
+			return 0;
+		}
+
+		/* The remainder of a partly written command must be queued
+		 * whatever the policy, or the stream would be corrupted. It can
+		 * no longer be merged, since part of it is already gone. */
+
+		if (sent) {
+			if (key == IGNI_CONN_NO_MERGE) {
+				raiseBarrier(conn, buf, len);
+			}
+
+			ringWrite(conn, conn->head, (const uint8_t*)buf + sent, len - sent);
+			conn->head += len - sent;
+			return 0;
+		}
+	}
+
+	if (conn->queueCap - (conn->head - conn->tail) < hdrSz + len) {
+		if (key != IGNI_CONN_NO_MERGE && conn->flags & IGNI_CONN_DROP_TRANSFORMS) {
+			return 0;
+		}
+
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (hdrSz) {
+		IgniConnFrameHeader hdr;
+		hdr.len = len;
+		hdr.count = count;
+
+		ringWrite(conn, conn->head, &hdr, sizeof(hdr));
+		conn->head += sizeof(hdr);
+	}
+
+	if (slot) {
+		slot->key = key;
+		slot->pos = conn->head;
+	} else if (key == IGNI_CONN_NO_MERGE) {
+		raiseBarrier(conn, buf, len);
+	}
+
+	ringWrite(conn, conn->head, buf, len);
+	conn->head += len;
+
+	/* Writes are submitted when a batch ends, on igniConnFlush() and while
+	 * waiting for an event. Only a backlog worth a system call of its own
+	 * is submitted as it builds up. */
+
+	size_t unsubmitted = conn->head - conn->tail - conn->inflight;
+
+	if (
+		conn->uring &&
+		!conn->batchDepth &&
+		(unsubmitted >= URING_SUBMIT_SZ || unsubmitted >= conn->queueCap / 2)
+	) {
+		return kick(conn, fd);
+	}
+
+	return 0;
+}
+
+/* Largest frame payload a connection can send or queue */
+static size_t frameMax(Conn* conn)
+{
+	if (conn->queue && conn->queueCap - FRAME_HDR_SZ < IGNI_CONN_FRAME_MAX) {
+		return conn->queueCap - FRAME_HDR_SZ;
+	}
+
+	return IGNI_CONN_FRAME_MAX;
+}
+
+int igniConnSend(
+	int fd,
+	const void* buf,
+	size_t len,
+	IgniConnMergeKey key
+)
+{
+	if (igniGroupIs(fd)) {
+		return igniGroupSend(fd, buf, len, key);
+	}
+
+	Conn* conn = getConn(fd);
+	if (!conn) {
+		return sendAll(fd, buf, len);
+	}
+
+	/* Seqpacket connections collect batches to fill their frames. */
+
+	if (!conn->batchDepth || !(conn->compress || conn->seqpacket)) {
+		/* A batch kept by a failed igniConnEnd() has to go out first. */
+		if (conn->batchSz) {
+			if (
+				key != IGNI_CONN_NO_MERGE &&
+				conn->flags & IGNI_CONN_DROP_TRANSFORMS
+			) {
+				return 0;
+			}
+
+			errno = EAGAIN;
+			return -1;
+		}
+
+		return deliver(conn, fd, buf, len, key);
+	}
+
+	if (conn->seqpacket && len > frameMax(conn)) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	/* Room for the command and possibly the header of a new frame */
+	if (conn->batchSz + FRAME_HDR_SZ + len > conn->batchCap) {
+		size_t newCap = roundPow2(conn->batchSz + FRAME_HDR_SZ + len);
+		uint8_t* newBatch = realloc(conn->batch, newCap);
+
+		if (!newBatch) {
+			perror("realloc() in libigni batch failed");
+			return -1;
+		}
+
+		conn->batch = newBatch;
+		conn->batchCap = newCap;
+	}
+
+	if (conn->seqpacket) {
+		IgniConnFrameHeader hdr = {};
+
+		if (conn->batchSz) {
+			memcpy(&hdr, conn->batch + conn->frameStart, sizeof(hdr));
+		}
+
+		if (!conn->batchSz || hdr.len + len > frameMax(conn)) {
+			conn->frameStart = conn->batchSz;
+			conn->batchSz += sizeof(hdr);
+			hdr.len = 0;
+			hdr.count = 0;
+		}
+
+		hdr.len += len;
+		hdr.count += countCommands(conn, buf, len);
+		memcpy(conn->batch + conn->frameStart, &hdr, sizeof(hdr));
+	}
+
+	memcpy(conn->batch + conn->batchSz, buf, len);
+	conn->batchSz += len;
+
+	return 0;
+}
+
+/* Applied to each shard when a group is batched or compressed */
+static int setCork(int fd, int on)
+{
+	Conn* conn = getConn(fd);
+
+	if (!conn || !conn->tcp) {
+		return 0;
+	}
+
+	if (setsockopt(fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on)) == -1) {
+		perror("setsockopt() in libigni batch failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Send frames laid out back to back, queuing those the socket does not
+ * take if the connection is non-blocking. Returns the number of frames
+ * sent or queued, which falls short only when the queue is full. */
+static ssize_t deliverFrames(
+	Conn* conn,
+	int fd,
+	const uint8_t* buf,
+	size_t len
+)
+{
+	size_t done = 0;
+	size_t frames = 0;
+
+	/* Older frames have to reach the socket first, so only send directly
+	 * when nothing is queued. */
+
+	while (done < len && (!conn->queue || conn->head == conn->tail)) {
+		struct mmsghdr msgs[SEND_FRAMES] = {};
+		struct iovec iovs[SEND_FRAMES];
+
+		unsigned count = 0;
+		size_t off = done;
+
+		while (count < SEND_FRAMES && off < len) {
+			IgniConnFrameHeader hdr;
+			memcpy(&hdr, buf + off, sizeof(hdr));
+
+			iovs[count].iov_base = (void*)(buf + off);
+			iovs[count].iov_len = FRAME_HDR_SZ + hdr.len;
+			msgs[count].msg_hdr.msg_iov = &iovs[count];
+			msgs[count].msg_hdr.msg_iovlen = 1;
+
+			off += iovs[count++].iov_len;
+		}
+
+		int sent = sendmmsg(fd, msgs, count, conn->queue ? MSG_DONTWAIT : 0);
+
+		if (sent == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (conn->queue && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				break;
+			}
+
+			return -1;
+		}
+
+		for (int i = 0; i < sent; ++i) {
+			done += iovs[i].iov_len;
+		}
+
+		frames += sent;
+	}
+
+	while (done < len) {
+		IgniConnFrameHeader hdr;
+		memcpy(&hdr, buf + done, sizeof(hdr));
+
+		size_t frameSz = FRAME_HDR_SZ + hdr.len;
+
+		if (conn->queueCap - (conn->head - conn->tail) < frameSz) {
+			break;
+		}
+
+		ringWrite(conn, conn->head, buf + done, frameSz);
+		conn->head += frameSz;
+
+		done += frameSz;
+		++frames;
+	}
+
+	return frames;
+}
+
+/* Send the frames collected during a batch, compressing each of them on
+ * its own if compression is on. Frames refused by a full outbound queue
+ * are kept for the next call. */
+static int sendFrameBatch(Conn* conn, int fd)
+{
+	uint8_t* frames = conn->batch;
+	size_t framesSz = conn->batchSz;
+	size_t frameCount = 0;
+
+	/* A compressed frame is never larger than the frame it replaces. */
+
+	uint8_t* packed = NULL;
+
+	if (conn->compress) {
+		packed = malloc(conn->batchSz);
+		if (!packed) {
+			perror("malloc() in libigni batch failed");
+			return -1;
+		}
+
+		framesSz = 0;
+	}
+
+	for (size_t off = 0; off < conn->batchSz; ++frameCount) {
+		IgniConnFrameHeader hdr;
+		memcpy(&hdr, conn->batch + off, sizeof(hdr));
+
+		const uint8_t* raw = conn->batch + off + FRAME_HDR_SZ;
+		off += FRAME_HDR_SZ + hdr.len;
+
+		if (!packed) {
+			continue;
+		}
+
+		uint8_t* out = packed + framesSz;
+		uint8_t* block = out + FRAME_HDR_SZ;
+
+		size_t dataCap = 0;
+		if (hdr.len > IGNI_RENDER_COMPRESSED_SZ) {
+			dataCap = hdr.len - IGNI_RENDER_COMPRESSED_SZ;
+		}
+
+		size_t dataSz = igniCompress(
+			raw,
+			hdr.len,
+			block + IGNI_RENDER_COMPRESSED_SZ,
+			dataCap
+		);
+
+		if (dataSz) {
+			igniRndEncodeCompressed(block, hdr.len, dataSz);
+			hdr.len = IGNI_RENDER_COMPRESSED_SZ + dataSz;
+			hdr.count = 1;
+		} else {
+			memcpy(block, raw, hdr.len);
+		}
+
+		memcpy(out, &hdr, sizeof(hdr));
+		framesSz += FRAME_HDR_SZ + hdr.len;
+	}
+
+	if (packed) {
+		frames = packed;
+	}
+
+	ssize_t sent = deliverFrames(conn, fd, frames, framesSz);
+
+	free(packed);
+
+	if (sent == -1 || (size_t)sent == frameCount) {
+		conn->batchSz = 0;
+		return sent == -1 ? -1 : 0;
+	}
+
+	/* Drop the frames that went out, which are the same ones whether or
+	 * not they were compressed. */
+
+	size_t off = 0;
+	for (ssize_t i = 0; i < sent; ++i) {
+		IgniConnFrameHeader hdr;
+		memcpy(&hdr, conn->batch + off, sizeof(hdr));
+		off += FRAME_HDR_SZ + hdr.len;
+	}
+
+	memmove(conn->batch, conn->batch + off, conn->batchSz - off);
+	conn->batchSz -= off;
+	conn->frameStart -= off;
+
+	errno = EAGAIN;
+	return -1;
+}
+
+/* Send the commands collected during a batch as one compressed block, or
+ * as they are if they do not compress. A batch refused by a full outbound
+ * queue is kept for the next call. */
+static int sendBatch(Conn* conn, int fd)
+{
+	size_t rawSz = conn->batchSz;
+
+	if (!rawSz) {
+		return 0;
+	}
+
+	if (conn->seqpacket) {
+		return sendFrameBatch(conn, fd);
+	}
+
+	size_t blockSz = IGNI_RENDER_COMPRESSED_SZ + rawSz;
+	uint8_t* block = malloc(blockSz);
+
+	if (!block) {
+		perror("malloc() in libigni batch failed");
+		return -1;
+	}
+
+	/* Compression must save at least the size of the block header. */
+
+	size_t dataCap = 0;
+	if (rawSz > IGNI_RENDER_COMPRESSED_SZ) {
+		dataCap = rawSz - IGNI_RENDER_COMPRESSED_SZ;
+	}
+
+	size_t dataSz = igniCompress(
+		conn->batch,
+		rawSz,
+		block + IGNI_RENDER_COMPRESSED_SZ,
+		dataCap
+	);
+
+	int result;
+
+	if (dataSz && rawSz <= UINT32_MAX) {
+		igniRndEncodeCompressed(block, rawSz, dataSz);
+		result = deliver(
+			conn,
+			fd,
+			block,
+			IGNI_RENDER_COMPRESSED_SZ + dataSz,
+			IGNI_CONN_NO_MERGE
+		);
+	} else {
+		result = deliver(conn, fd, conn->batch, rawSz, IGNI_CONN_NO_MERGE);
+	}
+
+	free(block);
+
+	if (result == 0 || errno != EAGAIN) {
+		conn->batchSz = 0;
+	}
+
+	return result;
+}
+
+static int begin(int fd, int unused)
+{
+	(void)unused;
+
+	Conn* conn = getConn(fd);
+
+	if (!conn || conn->batchDepth++) {
+		return 0;
+	}
+
+	return setCork(fd, 1);
+}
+
+static int end(int fd, int unused)
+{
+	(void)unused;
+
+	Conn* conn = getConn(fd);
+
+	if (!conn || (conn->batchDepth && --conn->batchDepth)) {
+		return 0;
+	}
+
+	/* A batch may name any element, so transforms queued before it are
+	 * no longer merged into. */
+
+	int batched = conn->batchSz != 0;
+	int result = sendBatch(conn, fd);
+
+	if (batched) {
+		conn->mergeFloor = conn->head;
+	}
+
+	if (conn->uring && kick(conn, fd) == -1) {
+		result = -1;
+	}
+
+	if (setCork(fd, 0) == -1) {
+		result = -1;
+	}
+
+	return result;
+}
+
+static int setCompression(int fd, int enabled)
+{
+	Conn* conn = newConn(fd);
+	if (!conn) {
+		return -1;
+	}
+
+	conn->compress = enabled;
+	return 0;
+}
+
+int igniConnBegin(int fd)
+{
+	if (igniGroupIs(fd)) {
+		return igniGroupForEach(fd, begin, 0);
+	}
+
+	/* Connections without state neither cork nor compress, so there is
+	 * nothing to do for them until they get some. */
+
+	if (!getConn(fd)) {
+		return 0;
+	}
+
+	return begin(fd, 0);
+}
+
+int igniConnEnd(int fd)
+{
+	if (igniGroupIs(fd)) {
+		return igniGroupForEach(fd, end, 0);
+	}
+
+	return end(fd, 0);
+}
+
+int igniConnSetCompression(
+	int fd,
+	int enabled
+)
+{
+	if (igniGroupIs(fd)) {
+		return igniGroupForEach(fd, setCompression, enabled);
+	}
+
+	return setCompression(fd, enabled);
+}
+
+/* Hand out the payload of received frames as a stream of bytes. Events
+ * never straddle frames, so they are read exactly as from a stream
+ * socket. */
+static ssize_t recvFrames(
+	Conn* conn,
+	int fd,
+	void* buf,
+	size_t len,
+	int flags
+)
+{
+	size_t slotSz = FRAME_HDR_SZ + IGNI_CONN_FRAME_MAX;
+
+	if (!conn->rx) {
+		conn->rx = malloc(RECV_FRAMES * slotSz);
+
+		if (!conn->rx) {
+			perror("malloc() in libigni receive failed");
+			return -1;
+		}
+	}
+
+	while (conn->rxPos == conn->rxLen) {
+		struct mmsghdr msgs[RECV_FRAMES] = {};
+		struct iovec iovs[RECV_FRAMES];
+
+		for (int i = 0; i < RECV_FRAMES; ++i) {
+			iovs[i].iov_base = conn->rx + i * slotSz;
+			iovs[i].iov_len = slotSz;
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		/* Wait for one frame, then take whatever others have arrived. */
+
+		int got = recvmmsg(
+			fd,
+			msgs,
+			RECV_FRAMES,
+			MSG_WAITFORONE | (flags & MSG_DONTWAIT),
+			NULL
+		);
+
+		if (got == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return -1;
+		}
+
+		/* Move payloads together. Each lies at or after its destination. */
+
+		conn->rxPos = 0;
+		conn->rxLen = 0;
+
+		for (int i = 0; i < got; ++i) {
+			uint8_t* frame = iovs[i].iov_base;
+			size_t frameSz = msgs[i].msg_len;
+
+			/* An empty datagram means the server has shut down. */
+			if (!frameSz) {
+				if (!conn->rxLen) {
+					return 0;
+				}
+				break;
+			}
+
+			IgniConnFrameHeader hdr;
+			memcpy(&hdr, frame, sizeof(hdr));
+
+			if (
+				msgs[i].msg_hdr.msg_flags & MSG_TRUNC ||
+				frameSz < FRAME_HDR_SZ ||
+				hdr.len != frameSz - FRAME_HDR_SZ
+			) {
+				printf("Malformed frame from Igni server.\n");
+				errno = EPROTO;
+				return -1;
+			}
+
+			memmove(conn->rx + conn->rxLen, frame + FRAME_HDR_SZ, hdr.len);
+			conn->rxLen += hdr.len;
+		}
+	}
+
+	size_t n = conn->rxLen - conn->rxPos;
+	if (n > len) {
+		n = len;
+	}
+
+	memcpy(buf, conn->rx + conn->rxPos, n);
+	conn->rxPos += n;
+
+	return n;
+}
+
+ssize_t igniConnRecv(
+	int fd,
+	void* buf,
+	size_t len,
+	int flags
+)
+{
+	Conn* conn = getConn(fd);
+
+	if (conn && conn->seqpacket) {
+		return recvFrames(conn, fd, buf, len, flags);
+	}
+
+	if (!conn || !conn->uring) {
+		return recv(fd, buf, len, flags);
+	}
+
+	/* The receive is submitted along with any queued writes, and waiting
+	 * for it collects their completions too. */
+
+	if (!conn->batchDepth) {
+		startWrite(conn, fd);
+	}
+
+	conn->recvDone = 0;
+
+	if (igniUringRecv(
+		fd,
+		buf,
+		len,
+		flags,
+		IGNI_URING_DATA(fd, IGNI_URING_RECV)
+	) == -1) {
+		return recv(fd, buf, len, flags);
+	}
+
+	while (!conn->recvDone) {
+		if (await() == -1) {
+			int error = errno;
+			cancelRecv(conn, fd);
+
+			/* The receive may have completed all the same. */
+			if (conn->recvResult < 0) {
+				errno = error;
+				return -1;
+			}
+		}
+	}
+
+	if (conn->recvResult < 0) {
+		errno = -conn->recvResult;
+		return -1;
+	}
+
+	return conn->recvResult;
+}
+
@@ -0,0 +1,229 @@
+#ifndef _LIBIGNI_CONN_H
+#define _LIBIGNI_CONN_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+///
+/// @brief Non-blocking connection behaviour
+///
+typedef uint8_t IgniConnFlags;
+enum {
+	///
+	/// @brief Overwrite a queued, unsent transform of the same element
+	/// instead of queuing another one
+	///
+	IGNI_CONN_MERGE_TRANSFORMS = 1 << 0,
+
+	///
+	/// @brief Discard transforms that do not fit in the outbound queue
+	/// instead of reporting back-pressure
+	///
+	/// \note
+	/// - A dropped transform is reported as sent. The element keeps its
+	///   previous transform until another one is sent.
+	///
+	IGNI_CONN_DROP_TRANSFORMS = 1 << 1,
+
+	///
+	/// @brief Write the outbound queue and receive events through io_uring
+	///
+	/// \note
+	/// - Writes complete in the background and are collected by later
+	///   calls, so sending never waits on the socket.
+	/// - Queued commands are submitted to the kernel by igniConnFlush(),
+	///   igniConnEnd() and igniHitEventRecv(), or once enough of them
+	///   build up. Flush regularly, such as once per frame.
+	/// - All connections share one ring. Waiting for an event also submits
+	///   the queued writes of every connection.
+	/// - Receiving stays synchronous. igniHitEventRecv() still blocks until
+	///   data arrives, but submits and collects writes in the same system
+	///   call rather than costing one of its own.
+	/// - Falls back to send() and recv() where io_uring is unavailable.
+	/// - Seqpacket connections do not use io_uring.
+	/// - Only takes effect the first time a connection is made
+	///   non-blocking.
+	///
+	IGNI_CONN_IO_URING = 1 << 2
+};
+
+///
+/// @brief Key identifying commands which supersede each other
+///
+/// \note
+/// - Zero marks a command that must never be merged or dropped.
+///
+typedef uint64_t IgniConnMergeKey;
+#define IGNI_CONN_NO_MERGE 0
+#define IGNI_CONN_MERGE_KEY(opcode, id) \
+	(((IgniConnMergeKey)(opcode) << 32) | (uint32_t)(id))
+
+///
+/// @brief Start of every datagram on a SOCK_SEQPACKET connection
+///
+/// Seqpacket connections carry whole commands, and hit events, in frames:
+/// a header followed by len bytes holding count commands or events. Since
+/// none is ever split across frames, each datagram can be decoded on its
+/// own.
+///
+/// \note
+/// - A frame holds at most IGNI_CONN_FRAME_MAX bytes after its header.
+///   Larger commands are rejected with EMSGSIZE, and servers limit query
+///   results so that each event fits in a frame.
+/// - Commands sent outside a batch get a frame each. Batches fill frames.
+/// - With compression enabled, each frame of a batch is compressed on
+///   its own into a single compressed command.
+/// - Connections made with igniConnConnect() alone, rather than by
+///   igniRndOpenAt() or igniHitOpenAt(), cannot tell commands apart and
+///   count each igniConnSend() as one.
+///
+typedef struct {
+	uint32_t len;
+	uint32_t count;
+}__attribute__((packed)) IgniConnFrameHeader;
+
+#define IGNI_CONN_FRAME_MAX 65536
+
+///
+/// @brief Connect to an Igni server
+///
+/// \note
+/// - Endpoints of the form tcp://host:port are reached over TCP, with
+///   Nagle's algorithm disabled.
+/// - Endpoints of the form seqpacket://path are reached over a
+///   SOCK_SEQPACKET UNIX domain socket, framed with IgniConnFrameHeader.
+///   If the server socket is a stream, the connection falls back to one.
+/// - Any other endpoint is the pathname of a UNIX domain socket.
+///
+/// @param endpoint 	Server address
+/// @return Non-negative file descriptor. -1 if an error occurred.
+///
+int igniConnConnect(const char* endpoint);
+
+///
+/// @brief Start a batch of commands
+///
+/// Until the matching igniConnEnd(), TCP connections hold back partly
+/// filled segments, and seqpacket connections and connections with
+/// compression enabled collect commands instead of sending them. Batches
+/// may be nested; only the outermost one takes effect.
+///
+/// @param fd 		File descriptor of server socket
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniConnBegin(int fd);
+
+///
+/// @brief Finish a batch of commands and send everything it held back
+///
+/// \note
+/// - If a non-blocking connection cannot queue a batch it collected, this
+///   fails with errno set to EAGAIN and keeps the batch. Call it again
+///   after igniConnFlush() has made room. Until then, commands sent outside
+///   a batch fail with EAGAIN too, or are dropped if they are transforms
+///   and IGNI_CONN_DROP_TRANSFORMS is set, so that none overtakes it.
+///
+/// @param fd 		File descriptor of server socket
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniConnEnd(int fd);
+
+///
+/// @brief Compress the commands of each batch before sending them
+///
+/// \note
+/// - Batches are sent as a single IGNI_RENDER_OP_COMPRESSED or
+///   IGNI_HIT_OP_COMPRESSED command holding an LZ4 block, unless they do
+///   not compress, in which case they are sent unchanged.
+/// - Only enable this for servers that accept compressed commands.
+///
+/// @param fd 		File descriptor of server socket
+/// @param enabled 	Non-zero to compress batches
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniConnSetCompression(
+	int fd,
+	int enabled
+);
+
+///
+/// @brief Switch a connection to non-blocking mode
+///
+/// Commands sent through the connection are written straight to the socket
+/// where possible. Bytes the socket does not accept are kept in a bounded
+/// outbound queue and written by later calls to igniConnFlush(). When the
+/// queue cannot take a command, the command function fails with errno set
+/// to EAGAIN and nothing is sent. Commands larger than the queue are
+/// rejected with EMSGSIZE.
+///
+/// @param fd 		File descriptor of server socket
+/// @param queueSz 	Outbound queue capacity in bytes
+/// @param flags 	IgniConnFlags controlling transforms under back-pressure
+/// @return 0 upon success. -1 to indicate an error.
+///
+/// \note
+/// - Connection state is not protected against concurrent access.
+///
+int igniConnSetNonBlocking(
+	int fd,
+	size_t queueSz,
+	IgniConnFlags flags
+);
+
+///
+/// @brief Write as much of the outbound queue as the socket accepts
+///
+/// @param fd 		File descriptor of server socket
+/// @return Number of bytes still queued. -1 to indicate an error.
+///
+ssize_t igniConnFlush(int fd);
+
+///
+/// @brief Get number of bytes waiting in the outbound queue
+///
+/// @param fd 		File descriptor of server socket
+/// @return Queued byte count. 0 for blocking connections.
+///
+size_t igniConnPending(int fd);
+
+///
+/// @brief Get events to wait for before calling igniConnFlush()
+///
+/// @param fd 		File descriptor of server socket
+/// @return EPOLLOUT if bytes are queued, 0 otherwise.
+///
+uint32_t igniConnEvents(int fd);
+
+///
+/// @brief Close connection and release its outbound queue
+///
+/// \note
+/// - Queued bytes that have not been flushed are discarded.
+///
+/// @param fd 		File descriptor of server socket
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniConnClose(int fd);
+
+///
+/// @brief Send an encoded command over a connection
+///
+/// Blocking connections send the whole command, resuming short writes.
+/// Non-blocking connections queue whatever the socket does not accept.
+///
+/// @param fd 		File descriptor of server socket
+/// @param buf 		Encoded command
+/// @param len 		Size of encoded command in bytes
+/// @param key 		Merge key of command, or IGNI_CONN_NO_MERGE
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniConnSend(
+	int fd,
+	const void* buf,
+	size_t len,
+	IgniConnMergeKey key
+);
+
+#endif
+
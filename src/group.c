@@ -0,0 +1,531 @@
+#include "group.h"
+#include "internal.h"
+#include "render.h"
+#include "hit.h"
+#include <stdio.h> 			/* perror() */
+#include <stdlib.h> 		/* malloc(), calloc(), realloc(), free() */
+#include <string.h> 		/* memcpy(), memset() */
+#include <errno.h> 			/* errno */
+#include <unistd.h> 		/* close() */
+#include <sys/eventfd.h> 	/* eventfd() */
+
+/* How a command is dispatched to the shards of a group */
+typedef uint8_t Route;
+enum {
+	ROUTE_FIRST = 0, 	/* first shard only */
+	ROUTE_ELEMENT, 		/* shard owning the element after the opcode */
+	ROUTE_SOURCE, 		/* shard owning the element copied from */
+	ROUTE_SPLIT, 		/* shards owning each element of a batch */
+	ROUTE_BROADCAST 	/* every shard */
+};
+
+static const Route rndRoutes[] = {
+	[IGNI_RENDER_OP_NUL] = ROUTE_FIRST,
+	[IGNI_RENDER_OP_CONFIGURE] = ROUTE_BROADCAST,
+
+	[IGNI_RENDER_OP_MESH_CREATE] = ROUTE_ELEMENT,
+	[IGNI_RENDER_OP_MESH_SET_SHADER] = ROUTE_ELEMENT,
+	[IGNI_RENDER_OP_MESH_BIND_TEXTURE] = ROUTE_ELEMENT,
+	[IGNI_RENDER_OP_MESH_TRANSFORM] = ROUTE_ELEMENT,
+	[IGNI_RENDER_OP_MESH_DELETE] = ROUTE_ELEMENT,
+
+	[IGNI_RENDER_OP_POINT_LIGHT_CREATE] = ROUTE_ELEMENT,
+	[IGNI_RENDER_OP_POINT_LIGHT_TRANSFORM] = ROUTE_ELEMENT,
+	[IGNI_RENDER_OP_POINT_LIGHT_SET_COLOUR] = ROUTE_ELEMENT,
+	[IGNI_RENDER_OP_POINT_LIGHT_DELETE] = ROUTE_ELEMENT,
+
+	/* Any mesh may bind any texture, so each shard needs all of them. */
+	[IGNI_RENDER_OP_TEXTURE_CREATE] = ROUTE_BROADCAST,
+	[IGNI_RENDER_OP_TEXTURE_DELETE] = ROUTE_BROADCAST,
+
+	[IGNI_RENDER_OP_VIEWPOINT_TRANSFORM] = ROUTE_BROADCAST,
+
+	[IGNI_RENDER_OP_BUNDLE_LOAD] = ROUTE_FIRST,
+
+	[IGNI_RENDER_OP_TEXTURE_STREAM_CREATE] = ROUTE_BROADCAST,
+	[IGNI_RENDER_OP_TEXTURE_STREAM_LEVEL] = ROUTE_BROADCAST,
+	[IGNI_RENDER_OP_TEXTURE_STREAM_PRIORITY] = ROUTE_BROADCAST,
+	[IGNI_RENDER_OP_TEXTURE_STREAM_CANCEL] = ROUTE_BROADCAST,
+
+	[IGNI_RENDER_OP_ELEMENT_SET_PARENT] = ROUTE_ELEMENT,
+
+	/* An instance can only be created where its source mesh is. */
+	[IGNI_RENDER_OP_MESH_INSTANCE_CREATE] = ROUTE_SOURCE,
+	[IGNI_RENDER_OP_MESH_TRANSFORM_BATCH] = ROUTE_SPLIT
+};
+
+static const Route hitRoutes[] = {
+	[IGNI_HIT_OP_NUL] = ROUTE_FIRST,
+	[IGNI_HIT_OP_CONFIGURE] = ROUTE_BROADCAST,
+
+	[IGNI_HIT_OP_HITBOX_CREATE] = ROUTE_ELEMENT,
+	[IGNI_HIT_OP_HITBOX_TRANSFORM] = ROUTE_ELEMENT,
+	[IGNI_HIT_OP_HITBOX_DELETE] = ROUTE_ELEMENT,
+
+	/* Each shard answers for its own hitboxes. */
+	[IGNI_HIT_OP_QUERY_RAYCAST] = ROUTE_BROADCAST,
+	[IGNI_HIT_OP_QUERY_OVERLAP_BOX] = ROUTE_BROADCAST,
+	[IGNI_HIT_OP_QUERY_CLOSEST] = ROUTE_BROADCAST,
+
+	[IGNI_HIT_OP_HITBOX_SET_FILTER] = ROUTE_ELEMENT,
+
+	[IGNI_HIT_OP_HITBOX_SET_PARENT] = ROUTE_ELEMENT,
+
+	[IGNI_HIT_OP_HITBOX_CREATE_SHAPED] = ROUTE_ELEMENT,
+	[IGNI_HIT_OP_HITBOX_TRANSFORM_SPHERE] = ROUTE_ELEMENT,
+	[IGNI_HIT_OP_HITBOX_TRANSFORM_CAPSULE] = ROUTE_ELEMENT
+};
+
+typedef struct {
+	IgniGroupProtocol protocol;
+	int* shards;
+	size_t shardCount;
+
+	IgniGroupRoute route;
+	void* user;
+} Group;
+
+/* Groups are looked up by the descriptor reserved for them, in the same
+ * way as connection state in conn.c. */
+static Group** groups;
+static size_t groupsSz;
+
+static Group* getGroup(int fd)
+{
+	if (fd < 0 || (size_t)fd >= groupsSz) {
+		return NULL;
+	}
+
+	return groups[fd];
+}
+
+static size_t routeById(
+	void* user,
+	uint8_t opcode,
+	uint32_t id,
+	size_t shardCount
+)
+{
+	(void)user;
+	(void)opcode;
+
+	return id / IGNI_GROUP_ROUTE_BLOCK % shardCount;
+}
+
+int igniGroupOpen(
+	IgniGroupProtocol protocol,
+	const char* const* endpoints,
+	size_t count
+)
+{
+	if (!count) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	Group* group = calloc(1, sizeof(Group));
+	if (!group) {
+		perror("calloc() in igniGroupOpen() failed");
+		return -1;
+	}
+
+	group->protocol = protocol;
+	group->route = routeById;
+	group->shards = malloc(count * sizeof(int));
+
+	if (!group->shards) {
+		perror("malloc() in igniGroupOpen() failed");
+		free(group);
+		return -1;
+	}
+
+	/* The group needs a descriptor of its own so that it can be passed to
+	 * the command functions. An eventfd is the cheapest way to reserve
+	 * one. */
+
+	int fd = eventfd(0, EFD_CLOEXEC);
+	if (fd == -1) {
+		perror("eventfd() in igniGroupOpen() failed");
+		free(group->shards);
+		free(group);
+		return -1;
+	}
+
+	for (; group->shardCount < count; ++group->shardCount) {
+		const char* endpoint = endpoints[group->shardCount];
+		int shard = protocol == IGNI_GROUP_HIT ?
+			igniHitOpenAt(endpoint) :
+			igniRndOpenAt(endpoint);
+
+		if (shard == -1) {
+			goto fail;
+		}
+
+		group->shards[group->shardCount] = shard;
+	}
+
+	if ((size_t)fd >= groupsSz) {
+		size_t newSz = groupsSz ? groupsSz : 16;
+		while (newSz <= (size_t)fd) {
+			newSz *= 2;
+		}
+
+		Group** newGroups = realloc(groups, newSz * sizeof(*groups));
+		if (!newGroups) {
+			perror("realloc() in igniGroupOpen() failed");
+			goto fail;
+		}
+
+		memset(newGroups + groupsSz, 0, (newSz - groupsSz) * sizeof(*groups));
+		groups = newGroups;
+		groupsSz = newSz;
+	}
+
+	groups[fd] = group;
+	return fd;
+
+fail:
+	for (size_t i = 0; i < group->shardCount; ++i) {
+		igniConnClose(group->shards[i]);
+	}
+
+	close(fd);
+	free(group->shards);
+	free(group);
+	return -1;
+}
+
+int igniGroupSetRoute(
+	int fd,
+	IgniGroupRoute route,
+	void* user
+)
+{
+	Group* group = getGroup(fd);
+	if (!group) {
+		errno = EBADF;
+		return -1;
+	}
+
+	group->route = route ? route : routeById;
+	group->user = user;
+
+	return 0;
+}
+
+size_t igniGroupShardCount(int fd)
+{
+	Group* group = getGroup(fd);
+	return group ? group->shardCount : 0;
+}
+
+int igniGroupShard(
+	int fd,
+	size_t index
+)
+{
+	Group* group = getGroup(fd);
+	if (!group || index >= group->shardCount) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return group->shards[index];
+}
+
+int igniGroupClose(int fd)
+{
+	Group* group = getGroup(fd);
+	if (!group) {
+		errno = EBADF;
+		return -1;
+	}
+
+	int result = 0;
+
+	for (size_t i = 0; i < group->shardCount; ++i) {
+		if (igniConnClose(group->shards[i]) == -1) {
+			result = -1;
+		}
+	}
+
+	groups[fd] = NULL;
+	free(group->shards);
+	free(group);
+
+	if (close(fd) == -1) {
+		result = -1;
+	}
+
+	return result;
+}
+
+int igniGroupIs(int fd)
+{
+	return getGroup(fd) != NULL;
+}
+
+int igniGroupSetNonBlocking(
+	int fd,
+	size_t queueSz,
+	IgniConnFlags flags
+)
+{
+	Group* group = getGroup(fd);
+
+	for (size_t i = 0; i < group->shardCount; ++i) {
+		if (igniConnSetNonBlocking(group->shards[i], queueSz, flags) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int igniGroupForEach(
+	int fd,
+	int (*fn)(int shard, int arg),
+	int arg
+)
+{
+	Group* group = getGroup(fd);
+	int result = 0;
+
+	for (size_t i = 0; i < group->shardCount; ++i) {
+		if (fn(group->shards[i], arg) == -1) {
+			result = -1;
+		}
+	}
+
+	return result;
+}
+
+/* Find the end of the run of consecutive meshes of a transform batch that
+ * starts at 'start' and belongs to the same shard. */
+static uint32_t findRun(
+	Group* group,
+	const IgniRndCmdMeshTransformBatch* cmd,
+	uint32_t start,
+	size_t* shard
+)
+{
+	*shard = group->route(
+		group->user,
+		IGNI_RENDER_OP_MESH_TRANSFORM_BATCH,
+		cmd->firstMeshId + start,
+		group->shardCount
+	);
+
+	for (uint32_t end = start + 1; end < cmd->count; ++end) {
+		size_t next = group->route(
+			group->user,
+			IGNI_RENDER_OP_MESH_TRANSFORM_BATCH,
+			cmd->firstMeshId + end,
+			group->shardCount
+		);
+
+		if (next != *shard) {
+			return end;
+		}
+	}
+
+	return cmd->count;
+}
+
+/* Send each run of a transform batch as a batch of its own. */
+static int sendRuns(
+	Group* group,
+	const IgniRndCmdMeshTransformBatch* cmd,
+	const uint8_t* records,
+	uint8_t* part
+)
+{
+	const size_t recordSz = sizeof(IgniRndTransformRecord);
+	int result = 0;
+
+	for (uint32_t start = 0, end; start < cmd->count; start = end) {
+		size_t shard;
+		end = findRun(group, cmd, start, &shard);
+
+		IgniRndCmdMeshTransformBatch partCmd;
+		partCmd.firstMeshId = cmd->firstMeshId + start;
+		partCmd.count = end - start;
+
+		size_t recordsSz = (size_t)partCmd.count * recordSz;
+
+		part[0] = IGNI_RENDER_OP_MESH_TRANSFORM_BATCH;
+		memcpy(part + sizeof(IgniRndOpcode), &partCmd, sizeof(partCmd));
+		memcpy(
+			part + IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ,
+			records + start * recordSz,
+			recordsSz
+		);
+
+		if (igniConnSend(
+			group->shards[shard],
+			part,
+			IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ + recordsSz,
+			IGNI_CONN_NO_MERGE
+		) == -1) {
+			result = -1;
+		}
+	}
+
+	return result;
+}
+
+/* Split a transform batch into runs of consecutive meshes that belong to
+ * the same shard. Unless every shard has room for its runs, none are sent,
+ * so that a retry after EAGAIN sends nothing twice. */
+static int sendTransformBatch(Group* group, const uint8_t* buf, size_t len)
+{
+	const size_t recordSz = sizeof(IgniRndTransformRecord);
+
+	if (len < IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	IgniRndCmdMeshTransformBatch cmd;
+	memcpy(&cmd, buf + sizeof(IgniRndOpcode), sizeof(cmd));
+
+	if ((len - IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ) / recordSz < cmd.count) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Bytes and number of runs bound for each shard */
+	size_t* sizes = calloc(2 * group->shardCount, sizeof(size_t));
+	size_t* runs = sizes + group->shardCount;
+	uint8_t* part = malloc(len);
+
+	if (!sizes || !part) {
+		perror("malloc() in libigni group send failed");
+		free(sizes);
+		free(part);
+		return -1;
+	}
+
+	int result = 0;
+
+	for (uint32_t start = 0, end; start < cmd.count; start = end) {
+		size_t shard;
+		end = findRun(group, &cmd, start, &shard);
+
+		if (shard >= group->shardCount) {
+			errno = EINVAL;
+			result = -1;
+			break;
+		}
+
+		sizes[shard] += IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ +
+			(size_t)(end - start) * recordSz;
+		++runs[shard];
+	}
+
+	for (size_t i = 0; result == 0 && i < group->shardCount; ++i) {
+		if (!igniConnHasRoom(group->shards[i], sizes[i], runs[i])) {
+			errno = EAGAIN;
+			result = -1;
+		}
+	}
+
+	if (result == 0) {
+		result = sendRuns(
+			group,
+			&cmd,
+			buf + IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ,
+			part
+		);
+	}
+
+	free(sizes);
+	free(part);
+	return result;
+}
+
+int igniGroupSend(
+	int fd,
+	const void* buf,
+	size_t len,
+	IgniConnMergeKey key
+)
+{
+	Group* group = getGroup(fd);
+
+	const Route* routes = rndRoutes;
+	size_t routeCount = sizeof(rndRoutes) / sizeof(*rndRoutes);
+
+	if (group->protocol == IGNI_GROUP_HIT) {
+		routes = hitRoutes;
+		routeCount = sizeof(hitRoutes) / sizeof(*hitRoutes);
+	}
+
+	uint8_t opcode = *(const uint8_t*)buf;
+	Route route = opcode < routeCount ? routes[opcode] : ROUTE_FIRST;
+
+	if (route == ROUTE_BROADCAST) {
+		int result = 0;
+
+		for (size_t i = 0; i < group->shardCount; ++i) {
+			if (igniConnSend(group->shards[i], buf, len, key) == -1) {
+				result = -1;
+			}
+		}
+
+		return result;
+	}
+
+	if (route == ROUTE_SPLIT) {
+		return sendTransformBatch(group, buf, len);
+	}
+
+	size_t shard = 0;
+
+	if (route == ROUTE_ELEMENT || route == ROUTE_SOURCE) {
+		size_t offset = route == ROUTE_SOURCE ? 1 + sizeof(uint32_t) : 1;
+
+		uint32_t id;
+		memcpy(&id, (const uint8_t*)buf + offset, sizeof(id));
+
+		shard = group->route(group->user, opcode, id, group->shardCount);
+	}
+
+	if (shard >= group->shardCount) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return igniConnSend(group->shards[shard], buf, len, key);
+}
+
+ssize_t igniGroupFlush(int fd)
+{
+	Group* group = getGroup(fd);
+	ssize_t pending = 0;
+
+	for (size_t i = 0; i < group->shardCount; ++i) {
+		ssize_t shardPending = igniConnFlush(group->shards[i]);
+
+		if (shardPending == -1) {
+			return -1;
+		}
+
+		pending += shardPending;
+	}
+
+	return pending;
+}
+
+size_t igniGroupPending(int fd)
+{
+	Group* group = getGroup(fd);
+	size_t pending = 0;
+
+	for (size_t i = 0; i < group->shardCount; ++i) {
+		pending += igniConnPending(group->shards[i]);
+	}
+
+	return pending;
+}
+
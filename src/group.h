@@ -0,0 +1,134 @@
+#ifndef _LIBIGNI_GROUP_H
+#define _LIBIGNI_GROUP_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+///
+/// @brief Protocol spoken by every server of a connection group
+///
+typedef uint8_t IgniGroupProtocol;
+enum {
+	IGNI_GROUP_RENDER = 0,
+	IGNI_GROUP_HIT
+};
+
+///
+/// @brief Number of consecutive element IDs owned by the same shard unless
+/// igniGroupSetRoute() says otherwise
+///
+#define IGNI_GROUP_ROUTE_BLOCK 256
+
+///
+/// @brief Choose the shard owning a scene element
+///
+/// @param user 	Pointer given to igniGroupSetRoute()
+/// @param opcode 	Command number of the command being routed
+/// @param id 		Element the command applies to
+/// @param shardCount 	Number of shards in the group
+/// @return Shard index below shardCount.
+///
+/// \note
+/// - Every command for an element must go to the same shard, so the choice
+///   may only depend on the element ID. Spatial sharding is done by
+///   picking the shard from where the caller spawns each element and
+///   remembering it.
+///
+typedef size_t (*IgniGroupRoute)(
+	void* user,
+	uint8_t opcode,
+	uint32_t id,
+	size_t shardCount
+);
+
+///
+/// @brief Open connections to several servers acting as one scene
+///
+/// The returned descriptor can be passed to every igniRnd or igniHit
+/// command function in place of a single connection. Commands for an
+/// element are sent to the shard owning it. Unless igniGroupSetRoute() says
+/// otherwise, blocks of IGNI_GROUP_ROUTE_BLOCK consecutive IDs are dealt out
+/// to the shards in turn, so that batches over consecutive elements mostly
+/// stay whole. Commands affecting the whole scene, such as
+/// igniRndViewpointTransform() and texture creation, are sent to every
+/// shard.
+///
+/// @param protocol 	Protocol of the servers
+/// @param endpoints 	Pathnames of server sockets
+/// @param count 	Number of endpoints
+/// @return Non-negative group descriptor. -1 if an error occurred.
+///
+/// \note
+/// - The group descriptor only identifies the group. It must not be read,
+///   written or polled directly.
+/// - igniConnSetNonBlocking(), igniConnFlush(), igniConnPending() and
+///   igniConnClose() apply to every shard of a group. Poll each shard
+///   from igniGroupShard() to learn when to flush.
+/// - Scene bundles are loaded by the first shard only. Send one bundle per
+///   shard through igniGroupShard() to spread a bundle's elements.
+/// - A parent and its children, and a mesh and its instances, must live on
+///   the same shard. Route them together with igniGroupSetRoute().
+/// - A mesh instance is created on the shard owning its source mesh, so the
+///   route is given the source ID with IGNI_RENDER_OP_MESH_INSTANCE_CREATE.
+/// - A mesh transform batch is split into one batch per run of consecutive
+///   meshes owned by the same shard. If any shard lacks queue space for its
+///   runs, the whole batch fails with EAGAIN and nothing is sent.
+/// - Hit queries are broadcast, and every shard reports results for its
+///   own hitboxes under the same request ID.
+/// - A broadcast command fails if any shard fails, and may still have been
+///   sent to the other shards.
+///
+int igniGroupOpen(
+	IgniGroupProtocol protocol,
+	const char* const* endpoints,
+	size_t count
+);
+
+///
+/// @brief Replace the shard chosen for each element
+///
+/// @param fd 		Group descriptor
+/// @param route 	Shard selection function, or NULL for blocks of IDs
+/// @param user 	Pointer passed to route
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniGroupSetRoute(
+	int fd,
+	IgniGroupRoute route,
+	void* user
+);
+
+///
+/// @brief Get number of shards in a group
+///
+/// @param fd 		Group descriptor
+/// @return Shard count. 0 if fd is not a group.
+///
+size_t igniGroupShardCount(int fd);
+
+///
+/// @brief Get connection of a single shard
+///
+/// \note
+/// - The shard connection can be made non-blocking with
+///   igniConnSetNonBlocking() and polled on its own.
+///
+/// @param fd 		Group descriptor
+/// @param index 	Shard index
+/// @return File descriptor of shard. -1 if there is no such shard.
+///
+int igniGroupShard(
+	int fd,
+	size_t index
+);
+
+///
+/// @brief Close every connection of a group
+///
+/// @param fd 		Group descriptor
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniGroupClose(int fd);
+
+#endif
+
@@ -1,23 +1,115 @@
 #include "hit.h"
-#include <stdio.h> /* perror() */
-#include <sys/socket.h> /* send() */
+#include "conn.h"
+#include "internal.h"
+#include <stdio.h> /* printf(), perror() */
+#include <errno.h> /* errno */
+#include <stdlib.h> /* getenv() */
+#include <stddef.h> /* offsetof() */
+#include <sys/socket.h> /* MSG_WAITALL */
+
+/* Command and event layouts are derived from the same structures and
+ * sizes as the encoders in hit.h, so the two cannot disagree. */
+
+#define FIXED(sz) { \
+	.fixedSz = (sz), \
+	.version = IGNI_HIT_VERSION \
+}
+
+#define VARIABLE(sz, type, countField, elemSz_) { \
+	.fixedSz = (sz), \
+	.countOffset = sizeof(IgniHitOpcode) + offsetof(type, countField), \
+	.countSz = sizeof(((type*)0)->countField), \
+	.version = IGNI_HIT_VERSION, \
+	.elemSz = (elemSz_) \
+}
+
+const IgniOpcodeDesc igniHitOpcodes[256] = {
+	[IGNI_HIT_OP_CONFIGURE] = FIXED(IGNI_HIT_CONFIGURE_SZ),
+
+	[IGNI_HIT_OP_HITBOX_CREATE] = FIXED(IGNI_HIT_HITBOX_CREATE_SZ),
+	[IGNI_HIT_OP_HITBOX_TRANSFORM] = FIXED(IGNI_HIT_HITBOX_TRANSFORM_SZ),
+	[IGNI_HIT_OP_HITBOX_DELETE] = FIXED(IGNI_HIT_HITBOX_DELETE_SZ),
+
+	[IGNI_HIT_OP_QUERY_RAYCAST] = FIXED(IGNI_HIT_QUERY_RAYCAST_SZ),
+	[IGNI_HIT_OP_QUERY_OVERLAP_BOX] = FIXED(IGNI_HIT_QUERY_OVERLAP_BOX_SZ),
+	[IGNI_HIT_OP_QUERY_CLOSEST] = FIXED(IGNI_HIT_QUERY_CLOSEST_SZ),
+
+	[IGNI_HIT_OP_HITBOX_SET_FILTER] = FIXED(IGNI_HIT_HITBOX_SET_FILTER_SZ),
+
+	[IGNI_HIT_OP_HITBOX_SET_PARENT] = FIXED(IGNI_HIT_HITBOX_SET_PARENT_SZ),
+
+	[IGNI_HIT_OP_HITBOX_CREATE_SHAPED] =
+		FIXED(IGNI_HIT_HITBOX_CREATE_SHAPED_SZ),
+	[IGNI_HIT_OP_HITBOX_TRANSFORM_SPHERE] =
+		FIXED(IGNI_HIT_HITBOX_TRANSFORM_SPHERE_SZ),
+	[IGNI_HIT_OP_HITBOX_TRANSFORM_CAPSULE] =
+		FIXED(IGNI_HIT_HITBOX_TRANSFORM_CAPSULE_SZ),
+
+	[IGNI_HIT_OP_COMPRESSED] = VARIABLE(
+		IGNI_HIT_COMPRESSED_SZ,
+		IgniHitCmdCompressed,
+		dataLen,
+		1
+	)
+};
+
+const IgniOpcodeDesc igniHitEvents[256] = {
+	[IGNI_HIT_EVENT_HITBOX_TRIGGER] = FIXED(IGNI_HIT_HITBOX_TRIGGER_SZ),
+	[IGNI_HIT_EVENT_HITBOX_RELEASE] = FIXED(IGNI_HIT_HITBOX_RELEASE_SZ),
+
+	[IGNI_HIT_EVENT_QUERY_RESULTS] = VARIABLE(
+		IGNI_HIT_QUERY_RESULTS_SZ,
+		IgniHitEventQueryResults,
+		resultCount,
+		sizeof(IgniHitQueryResult)
+	)
+};
+
+int igniHitOpen()
+{
+	char* endpoint = getenv("IGNI_HIT_SRV");
+
+	if (!endpoint) {
+		printf("Could not find environment variable 'IGNI_HIT_SRV'.\n");
+		return -1;
+	}
+
+	return igniHitOpenAt(endpoint);
+}
+
+int igniHitOpenAt(const char* endpoint)
+{
+	int fd = igniConnConnect(endpoint);
+	if (fd == -1) {
+		return -1;
+	}
+
+	igniConnSetOpcodes(fd, igniHitOpcodes);
+
+	uint8_t configure[IGNI_HIT_CONFIGURE_SZ];
+	size_t configureSz = igniHitEncodeConfigure(configure, IGNI_HIT_VERSION);
+
+	if (igniConnSend(fd, configure, configureSz, IGNI_CONN_NO_MERGE) == -1) {
+		perror("send() in igniHitOpenAt() failed");
+		igniConnClose(fd);
+		return -1;
+	}
+
+	return fd;
+}
 
 int igniHitHitboxCreate(
 	int fd,
 	IgniHitElementId id
 )
 {
-	struct HitboxCreateCmd {
-		IgniHitOpcode opcode;
-		IgniHitCmdHitboxCreate cmd;
-	};
+	uint8_t cmd[IGNI_HIT_HITBOX_CREATE_SZ];
+	size_t cmdSz = igniHitEncodeHitboxCreate(cmd, id);
 
-	struct HitboxCreateCmd hitboxCreate = {};
-	hitboxCreate.opcode = IGNI_HIT_OP_HITBOX_CREATE;	
-	hitboxCreate.cmd.hitboxId = id;	
-
-	if (send(fd, &hitboxCreate, sizeof(hitboxCreate), 0) == -1) {
-		perror("send() in igniHitHitboxCreate() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxCreate() failed");
+		}
 		return -1;
 	}
 
@@ -30,29 +122,15 @@ int igniHitHitboxTransform(
 	IgniTransform tf
 )
 {
-	struct HitboxTransformCmd {
-		IgniHitOpcode opcode;
-		IgniHitCmdHitboxTransform cmd;
-	};
-
-	struct HitboxTransformCmd hitboxTransform = {};
-	hitboxTransform.opcode = IGNI_HIT_OP_HITBOX_TRANSFORM;	
-	hitboxTransform.cmd.hitboxId = id;	
-
-	hitboxTransform.cmd.xLoc = tf.location.x;
-	hitboxTransform.cmd.yLoc = tf.location.y;
-	hitboxTransform.cmd.zLoc = tf.location.z;
-	
-	hitboxTransform.cmd.xRot = tf.rotation.x;
-	hitboxTransform.cmd.yRot = tf.rotation.y;
-	hitboxTransform.cmd.zRot = tf.rotation.z;
-
-	hitboxTransform.cmd.width = tf.scale.x;
-	hitboxTransform.cmd.height = tf.scale.y;
-	hitboxTransform.cmd.depth = tf.scale.z;
-
-	if (send(fd, &hitboxTransform, sizeof(hitboxTransform), 0) == -1) {
-		perror("send() in igniHitHitboxTransform() failed");
+	uint8_t cmd[IGNI_HIT_HITBOX_TRANSFORM_SZ];
+	size_t cmdSz = igniHitEncodeHitboxTransform(cmd, id, tf);
+	IgniConnMergeKey key;
+	key = IGNI_CONN_MERGE_KEY(IGNI_HIT_OP_HITBOX_TRANSFORM, id);
+
+	if (igniConnSend(fd, cmd, cmdSz, key) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxTransform() failed");
+		}
 		return -1;
 	}
 
@@ -64,20 +142,276 @@ int igniHitHitboxDelete(
 	IgniHitElementId id
 )
 {
-	struct HitboxDeleteCmd {
-		IgniHitOpcode opcode;
-		IgniHitCmdHitboxDelete cmd;
-	};
+	uint8_t cmd[IGNI_HIT_HITBOX_DELETE_SZ];
+	size_t cmdSz = igniHitEncodeHitboxDelete(cmd, id);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxDelete() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+int igniHitQueryRaycast(
+	int fd,
+	IgniHitRequestId requestId,
+	IgniVec3 origin,
+	IgniVec3 dir,
+	float maxDistance,
+	uint16_t maxHits
+)
+{
+	uint8_t cmd[IGNI_HIT_QUERY_RAYCAST_SZ];
+	size_t cmdSz = igniHitEncodeQueryRaycast(
+		cmd,
+		requestId,
+		origin,
+		dir,
+		maxDistance,
+		maxHits
+	);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitQueryRaycast() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+int igniHitQueryOverlapBox(
+	int fd,
+	IgniHitRequestId requestId,
+	IgniTransform box,
+	uint16_t maxHits
+)
+{
+	uint8_t cmd[IGNI_HIT_QUERY_OVERLAP_BOX_SZ];
+	size_t cmdSz = igniHitEncodeQueryOverlapBox(cmd, requestId, box, maxHits);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitQueryOverlapBox() failed");
+		}
+		return -1;
+	}
 
-	struct HitboxDeleteCmd hitboxDelete = {};
-	hitboxDelete.opcode = IGNI_HIT_OP_HITBOX_CREATE;	
-	hitboxDelete.cmd.hitboxId = id;	
+	return 0;
+}
+
+int igniHitQueryClosest(
+	int fd,
+	IgniHitRequestId requestId,
+	IgniVec3 point,
+	float maxDistance
+)
+{
+	uint8_t cmd[IGNI_HIT_QUERY_CLOSEST_SZ];
+	size_t cmdSz = igniHitEncodeQueryClosest(cmd, requestId, point, maxDistance);
 
-	if (send(fd, &hitboxDelete, sizeof(hitboxDelete), 0) == -1) {
-		perror("send() in igniHitHitboxDelete() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitQueryClosest() failed");
+		}
 		return -1;
 	}
 
 	return 0;
 }
 
+/* Receive exactly len bytes. Returns 0 if the server closed the connection
+ * first. */
+static ssize_t recvAll(int fd, uint8_t* buf, size_t len)
+{
+	size_t got = 0;
+
+	while (got < len) {
+		ssize_t n = igniConnRecv(fd, buf + got, len - got, MSG_WAITALL);
+
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return -1;
+		}
+
+		if (n == 0) {
+			return 0;
+		}
+
+		got += n;
+	}
+
+	return got;
+}
+
+ssize_t igniHitEventRecv(
+	int fd,
+	void* buf,
+	size_t bufSz
+)
+{
+	uint8_t* dst = buf;
+	size_t have = 0;
+	size_t eventSz = 1;
+
+	/* Read the event number, then the rest of the fixed part, then the
+	 * tail if there is one. Each read is as large as the size known so far
+	 * allows, so that no event takes more than three of them. */
+
+	while (have < eventSz) {
+		if (eventSz > bufSz) {
+			errno = EMSGSIZE;
+			return -1;
+		}
+
+		ssize_t n = recvAll(fd, dst + have, eventSz - have);
+		if (n <= 0) {
+			return n;
+		}
+
+		have = eventSz;
+		eventSz = igniHitEventSz(dst, have);
+
+		if (!eventSz) {
+			printf("Unknown event %u from Igni Hit server.\n", dst[0]);
+			errno = EPROTO;
+			return -1;
+		}
+	}
+
+	return eventSz;
+}
+
+int igniHitHitboxCreateFiltered(
+	int fd,
+	IgniHitElementId id,
+	IgniHitLayerMask layers,
+	IgniHitLayerMask mask
+)
+{
+	/* Both commands go out in one piece so that the server never sees the
+	 * hitbox with the default filter. */
+
+	uint8_t cmd[IGNI_HIT_HITBOX_CREATE_SZ + IGNI_HIT_HITBOX_SET_FILTER_SZ];
+	size_t cmdSz = igniHitEncodeHitboxCreate(cmd, id);
+	cmdSz += igniHitEncodeHitboxSetFilter(cmd + cmdSz, id, layers, mask);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxCreateFiltered() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+int igniHitHitboxSetFilter(
+	int fd,
+	IgniHitElementId id,
+	IgniHitLayerMask layers,
+	IgniHitLayerMask mask
+)
+{
+	uint8_t cmd[IGNI_HIT_HITBOX_SET_FILTER_SZ];
+	size_t cmdSz = igniHitEncodeHitboxSetFilter(cmd, id, layers, mask);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxSetFilter() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+int igniHitHitboxSetParent(
+	int fd,
+	IgniHitElementId id,
+	IgniHitElementId parentId
+)
+{
+	uint8_t cmd[IGNI_HIT_HITBOX_SET_PARENT_SZ];
+	size_t cmdSz = igniHitEncodeHitboxSetParent(cmd, id, parentId);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxSetParent() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+int igniHitHitboxCreateShaped(
+	int fd,
+	IgniHitElementId id,
+	IgniHitShape shape
+)
+{
+	uint8_t cmd[IGNI_HIT_HITBOX_CREATE_SHAPED_SZ];
+	size_t cmdSz = igniHitEncodeHitboxCreateShaped(cmd, id, shape);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxCreateShaped() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+int igniHitHitboxTransformSphere(
+	int fd,
+	IgniHitElementId id,
+	IgniVec3 centre,
+	float radius
+)
+{
+	uint8_t cmd[IGNI_HIT_HITBOX_TRANSFORM_SPHERE_SZ];
+	size_t cmdSz = igniHitEncodeHitboxTransformSphere(cmd, id, centre, radius);
+	IgniConnMergeKey key;
+	key = IGNI_CONN_MERGE_KEY(IGNI_HIT_OP_HITBOX_TRANSFORM_SPHERE, id);
+
+	if (igniConnSend(fd, cmd, cmdSz, key) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxTransformSphere() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+int igniHitHitboxTransformCapsule(
+	int fd,
+	IgniHitElementId id,
+	IgniVec3 a,
+	IgniVec3 b,
+	float radius
+)
+{
+	uint8_t cmd[IGNI_HIT_HITBOX_TRANSFORM_CAPSULE_SZ];
+	size_t cmdSz = igniHitEncodeHitboxTransformCapsule(cmd, id, a, b, radius);
+	IgniConnMergeKey key;
+	key = IGNI_CONN_MERGE_KEY(IGNI_HIT_OP_HITBOX_TRANSFORM_CAPSULE, id);
+
+	if (igniConnSend(fd, cmd, cmdSz, key) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniHitHitboxTransformCapsule() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
@@ -8,6 +8,9 @@
 
 #include "types.h"
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
 
 /// 
 /// @brief Command number
@@ -19,7 +22,23 @@ enum {
 
 	IGNI_HIT_OP_HITBOX_CREATE,
 	IGNI_HIT_OP_HITBOX_TRANSFORM,
-	IGNI_HIT_OP_HITBOX_DELETE
+	IGNI_HIT_OP_HITBOX_DELETE,
+
+	IGNI_HIT_OP_QUERY_RAYCAST,
+	IGNI_HIT_OP_QUERY_OVERLAP_BOX,
+	IGNI_HIT_OP_QUERY_CLOSEST,
+
+	IGNI_HIT_OP_HITBOX_SET_FILTER,
+
+	IGNI_HIT_OP_HITBOX_SET_PARENT,
+
+	IGNI_HIT_OP_HITBOX_CREATE_SHAPED,
+	IGNI_HIT_OP_HITBOX_TRANSFORM_SPHERE,
+	IGNI_HIT_OP_HITBOX_TRANSFORM_CAPSULE,
+
+	/* Kept apart from the other commands so that both protocols frame
+	 * compressed blocks the same way. */
+	IGNI_HIT_OP_COMPRESSED = 0xff
 };
 
 /// 
@@ -30,7 +49,9 @@ enum {
 	IGNI_HIT_EVENT_NUL = 0,
 
 	IGNI_HIT_EVENT_HITBOX_TRIGGER,
-	IGNI_HIT_EVENT_HITBOX_RELEASE
+	IGNI_HIT_EVENT_HITBOX_RELEASE,
+
+	IGNI_HIT_EVENT_QUERY_RESULTS
 };
 
 /// 
@@ -59,6 +80,9 @@ typedef struct {
 ///
 /// @brief Set hitbox location, rotation and dimensions
 ///
+/// \note
+/// - Only applies to box hitboxes, see IgniHitShape.
+///
 typedef struct {
 	IgniHitElementId hitboxId;
 	float xLoc, yLoc, zLoc;
@@ -87,6 +111,672 @@ typedef struct {
 	IgniHitElementId hitboxId;
 }__attribute__((packed)) IgniHitEventHitboxRelease;
 
+///
+/// @brief Client-chosen number matching query results to their query
+///
+typedef uint32_t IgniHitRequestId;
+
+///
+/// @brief Find hitboxes crossed by a ray, nearest first
+///
+typedef struct {
+	IgniHitRequestId requestId;
+	float xOrigin, yOrigin, zOrigin;
+	float xDir, yDir, zDir;
+	float maxDistance;
+	uint16_t maxHits;
+}__attribute__((packed)) IgniHitCmdQueryRaycast;
+
+///
+/// @brief Find hitboxes intersecting an oriented box
+///
+typedef struct {
+	IgniHitRequestId requestId;
+	float xLoc, yLoc, zLoc;
+	float xRot, yRot, zRot;
+	float width, height, depth;
+	uint16_t maxHits;
+}__attribute__((packed)) IgniHitCmdQueryOverlapBox;
+
+///
+/// @brief Find the hitbox closest to a point
+///
+typedef struct {
+	IgniHitRequestId requestId;
+	float xLoc, yLoc, zLoc;
+	float maxDistance;
+}__attribute__((packed)) IgniHitCmdQueryClosest;
+
+///
+/// @brief One hitbox found by a query
+///
+/// \note
+/// - For ray casts the location is where the ray enters the hitbox. For
+///   closest hitbox queries it is the nearest point on the hitbox. For
+///   box overlaps it is the hitbox location and the distance is 0.
+///
+typedef struct {
+	IgniHitRequestId requestId;
+	IgniHitElementId hitboxId;
+	float distance;
+	float xLoc, yLoc, zLoc;
+}__attribute__((packed)) IgniHitQueryResult;
+
+///
+/// @brief Results of one or more queries
+///
+/// \note
+/// - The results of a query are never split across batches.
+/// - A query which found nothing reports a single result with hitboxId set
+///   to IGNI_HIT_NULL_ELEMENT.
+///
+typedef struct {
+	uint16_t resultCount;
+	IgniHitQueryResult results[];
+}__attribute__((packed)) IgniHitEventQueryResults;
+
+///
+/// @brief Set of collision layers, one bit per layer
+///
+typedef uint32_t IgniHitLayerMask;
+
+///
+/// @brief Layers a hitbox occupies by default
+///
+#define IGNI_HIT_DEFAULT_LAYERS ((IgniHitLayerMask)1)
+
+///
+/// @brief Layers a hitbox interacts with by default
+///
+#define IGNI_HIT_ALL_LAYERS ((IgniHitLayerMask)-1)
+
+///
+/// @brief Choose which hitboxes a hitbox interacts with
+///
+/// \note
+/// - Two hitboxes interact only if each one's mask includes a layer of
+///   the other. Pairs that do not interact are never tested and never
+///   produce trigger or release events.
+/// - New hitboxes occupy IGNI_HIT_DEFAULT_LAYERS and interact with
+///   IGNI_HIT_ALL_LAYERS.
+///
+typedef struct {
+	IgniHitElementId hitboxId;
+	IgniHitLayerMask layers;
+	IgniHitLayerMask mask;
+}__attribute__((packed)) IgniHitCmdHitboxSetFilter;
+
+///
+/// @brief Sequence of whole commands compressed as one LZ4 block
+///
+/// \note
+/// - Sent by connections with compression enabled, see
+///   igniConnSetCompression().
+/// - data holds dataLen bytes which decompress to rawLen bytes of
+///   commands.
+///
+typedef struct {
+	uint32_t rawLen;
+	uint32_t dataLen;
+	uint8_t data[];
+}__attribute__((packed)) IgniHitCmdCompressed;
+
+///
+/// @brief Attach hitbox to a parent hitbox
+///
+/// \note
+/// - Transforms sent for the child afterwards are relative to the parent,
+///   and the child follows every later transform of the parent.
+/// - A parentId of IGNI_HIT_NULL_ELEMENT detaches the child, whose
+///   transforms become world-space again.
+/// - The dimensions of a child are not scaled by its parent.
+///
+typedef struct {
+	IgniHitElementId hitboxId;
+	IgniHitElementId parentId;
+}__attribute__((packed)) IgniHitCmdHitboxSetParent;
+
+///
+/// @brief Geometry of a hitbox
+///
+typedef uint8_t IgniHitShape;
+enum {
+	IGNI_HIT_SHAPE_BOX = 0,
+	IGNI_HIT_SHAPE_SPHERE,
+	IGNI_HIT_SHAPE_CAPSULE
+};
+
+///
+/// @brief Add hitbox of a given shape to scene
+///
+/// \note
+/// - Hitboxes added with IgniHitCmdHitboxCreate are boxes.
+/// - The shape of a hitbox cannot change. Each shape is transformed by its
+///   own command, and transforms meant for another shape are ignored.
+///
+typedef struct {
+	IgniHitElementId hitboxId;
+	IgniHitShape shape;
+}__attribute__((packed)) IgniHitCmdHitboxCreateShaped;
+
+///
+/// @brief Set location and radius of a sphere hitbox
+///
+typedef struct {
+	IgniHitElementId hitboxId;
+	float xLoc, yLoc, zLoc;
+	float radius;
+}__attribute__((packed)) IgniHitCmdHitboxTransformSphere;
+
+///
+/// @brief Set segment and radius of a capsule hitbox
+///
+/// \note
+/// - The capsule holds every point within radius of the segment from
+///   (xA, yA, zA) to (xB, yB, zB).
+///
+typedef struct {
+	IgniHitElementId hitboxId;
+	float xA, yA, zA;
+	float xB, yB, zB;
+	float radius;
+}__attribute__((packed)) IgniHitCmdHitboxTransformCapsule;
+
+/* Command encoders
+ *
+ * The following functions write a single command, opcode included, into
+ * memory provided by the caller and return the number of bytes written.
+ * They are defined here so that they can be inlined into the caller,
+ * which may place commands in any buffer it likes before sending them.
+ *
+ * The destination must hold at least IGNI_HIT_*_SZ bytes. It needs no
+ * particular alignment. */
+
+_Static_assert(sizeof(IgniHitCmdConfigure) == 1, "IgniHitCmdConfigure");
+_Static_assert(sizeof(IgniHitCmdHitboxCreate) == 4, "IgniHitCmdHitboxCreate");
+_Static_assert(
+	sizeof(IgniHitCmdHitboxTransform) == 40,
+	"IgniHitCmdHitboxTransform"
+);
+_Static_assert(sizeof(IgniHitCmdHitboxDelete) == 4, "IgniHitCmdHitboxDelete");
+_Static_assert(
+	sizeof(IgniHitEventHitboxTrigger) == 4,
+	"IgniHitEventHitboxTrigger"
+);
+_Static_assert(
+	sizeof(IgniHitEventHitboxRelease) == 4,
+	"IgniHitEventHitboxRelease"
+);
+_Static_assert(sizeof(IgniHitCmdQueryRaycast) == 34, "IgniHitCmdQueryRaycast");
+_Static_assert(
+	sizeof(IgniHitCmdQueryOverlapBox) == 42,
+	"IgniHitCmdQueryOverlapBox"
+);
+_Static_assert(sizeof(IgniHitCmdQueryClosest) == 20, "IgniHitCmdQueryClosest");
+_Static_assert(sizeof(IgniHitQueryResult) == 24, "IgniHitQueryResult");
+_Static_assert(
+	sizeof(IgniHitEventQueryResults) == 2,
+	"IgniHitEventQueryResults"
+);
+_Static_assert(
+	sizeof(IgniHitCmdHitboxSetFilter) == 12,
+	"IgniHitCmdHitboxSetFilter"
+);
+_Static_assert(sizeof(IgniHitCmdCompressed) == 8, "IgniHitCmdCompressed");
+_Static_assert(
+	sizeof(IgniHitCmdHitboxSetParent) == 8,
+	"IgniHitCmdHitboxSetParent"
+);
+_Static_assert(
+	sizeof(IgniHitCmdHitboxCreateShaped) == 5,
+	"IgniHitCmdHitboxCreateShaped"
+);
+_Static_assert(
+	sizeof(IgniHitCmdHitboxTransformSphere) == 20,
+	"IgniHitCmdHitboxTransformSphere"
+);
+_Static_assert(
+	sizeof(IgniHitCmdHitboxTransformCapsule) == 32,
+	"IgniHitCmdHitboxTransformCapsule"
+);
+
+#define IGNI_HIT_CMD_SZ(type) (sizeof(IgniHitOpcode) + sizeof(type))
+#define IGNI_HIT_EVENT_SZ(type) (sizeof(IgniHitEvent) + sizeof(type))
+
+#define IGNI_HIT_CONFIGURE_SZ IGNI_HIT_CMD_SZ(IgniHitCmdConfigure)
+#define IGNI_HIT_HITBOX_CREATE_SZ IGNI_HIT_CMD_SZ(IgniHitCmdHitboxCreate)
+#define IGNI_HIT_HITBOX_TRANSFORM_SZ IGNI_HIT_CMD_SZ(IgniHitCmdHitboxTransform)
+#define IGNI_HIT_HITBOX_DELETE_SZ IGNI_HIT_CMD_SZ(IgniHitCmdHitboxDelete)
+
+#define IGNI_HIT_HITBOX_TRIGGER_SZ IGNI_HIT_EVENT_SZ(IgniHitEventHitboxTrigger)
+#define IGNI_HIT_HITBOX_RELEASE_SZ IGNI_HIT_EVENT_SZ(IgniHitEventHitboxRelease)
+
+#define IGNI_HIT_QUERY_RAYCAST_SZ IGNI_HIT_CMD_SZ(IgniHitCmdQueryRaycast)
+#define IGNI_HIT_QUERY_OVERLAP_BOX_SZ IGNI_HIT_CMD_SZ(IgniHitCmdQueryOverlapBox)
+#define IGNI_HIT_QUERY_CLOSEST_SZ IGNI_HIT_CMD_SZ(IgniHitCmdQueryClosest)
+
+#define IGNI_HIT_QUERY_RESULTS_SZ IGNI_HIT_EVENT_SZ(IgniHitEventQueryResults)
+#define IGNI_HIT_QUERY_RESULTS_MAX_SZ \
+	(IGNI_HIT_QUERY_RESULTS_SZ + UINT16_MAX * sizeof(IgniHitQueryResult))
+
+#define IGNI_HIT_HITBOX_SET_FILTER_SZ IGNI_HIT_CMD_SZ(IgniHitCmdHitboxSetFilter)
+#define IGNI_HIT_COMPRESSED_SZ IGNI_HIT_CMD_SZ(IgniHitCmdCompressed)
+#define IGNI_HIT_HITBOX_SET_PARENT_SZ IGNI_HIT_CMD_SZ(IgniHitCmdHitboxSetParent)
+
+#define IGNI_HIT_HITBOX_CREATE_SHAPED_SZ \
+	IGNI_HIT_CMD_SZ(IgniHitCmdHitboxCreateShaped)
+#define IGNI_HIT_HITBOX_TRANSFORM_SPHERE_SZ \
+	IGNI_HIT_CMD_SZ(IgniHitCmdHitboxTransformSphere)
+#define IGNI_HIT_HITBOX_TRANSFORM_CAPSULE_SZ \
+	IGNI_HIT_CMD_SZ(IgniHitCmdHitboxTransformCapsule)
+
+///
+/// @brief Encode connection configuration command
+///
+/// @param buf 		Destination of command
+/// @param majVersion 	Major protocol version used by the client
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeConfigure(void* buf, uint8_t majVersion)
+{
+	IgniHitCmdConfigure cmd = {};
+	cmd.majVersion = majVersion;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_CONFIGURE;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_CONFIGURE_SZ;
+}
+
+///
+/// @brief Encode hitbox creation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Hitbox identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeHitboxCreate(void* buf, IgniHitElementId id)
+{
+	IgniHitCmdHitboxCreate cmd;
+	cmd.hitboxId = id;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_HITBOX_CREATE;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_HITBOX_CREATE_SZ;
+}
+
+///
+/// @brief Encode hitbox transformation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Hitbox identification number
+/// @param tf 		Hitbox transformation
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeHitboxTransform(
+	void* buf,
+	IgniHitElementId id,
+	IgniTransform tf
+)
+{
+	IgniHitCmdHitboxTransform cmd;
+	cmd.hitboxId = id;
+
+	cmd.xLoc = tf.location.x;
+	cmd.yLoc = tf.location.y;
+	cmd.zLoc = tf.location.z;
+
+	cmd.xRot = tf.rotation.x;
+	cmd.yRot = tf.rotation.y;
+	cmd.zRot = tf.rotation.z;
+
+	cmd.width = tf.scale.x;
+	cmd.height = tf.scale.y;
+	cmd.depth = tf.scale.z;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_HITBOX_TRANSFORM;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_HITBOX_TRANSFORM_SZ;
+}
+
+///
+/// @brief Encode hitbox removal command
+///
+/// @param buf 		Destination of command
+/// @param id 		Hitbox identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeHitboxDelete(void* buf, IgniHitElementId id)
+{
+	IgniHitCmdHitboxDelete cmd;
+	cmd.hitboxId = id;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_HITBOX_DELETE;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_HITBOX_DELETE_SZ;
+}
+
+///
+/// @brief Encode ray cast query command
+///
+/// @param buf 		Destination of command
+/// @param requestId 	Number identifying the query's results
+/// @param origin 	Start of ray
+/// @param dir 		Direction of ray
+/// @param maxDistance 	Length of ray
+/// @param maxHits 	Maximum number of hitboxes to report
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeQueryRaycast(
+	void* buf,
+	IgniHitRequestId requestId,
+	IgniVec3 origin,
+	IgniVec3 dir,
+	float maxDistance,
+	uint16_t maxHits
+)
+{
+	IgniHitCmdQueryRaycast cmd;
+	cmd.requestId = requestId;
+
+	cmd.xOrigin = origin.x;
+	cmd.yOrigin = origin.y;
+	cmd.zOrigin = origin.z;
+
+	cmd.xDir = dir.x;
+	cmd.yDir = dir.y;
+	cmd.zDir = dir.z;
+
+	cmd.maxDistance = maxDistance;
+	cmd.maxHits = maxHits;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_QUERY_RAYCAST;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_QUERY_RAYCAST_SZ;
+}
+
+///
+/// @brief Encode box overlap query command
+///
+/// @param buf 		Destination of command
+/// @param requestId 	Number identifying the query's results
+/// @param box 		Location, rotation and dimensions of box
+/// @param maxHits 	Maximum number of hitboxes to report
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeQueryOverlapBox(
+	void* buf,
+	IgniHitRequestId requestId,
+	IgniTransform box,
+	uint16_t maxHits
+)
+{
+	IgniHitCmdQueryOverlapBox cmd;
+	cmd.requestId = requestId;
+
+	cmd.xLoc = box.location.x;
+	cmd.yLoc = box.location.y;
+	cmd.zLoc = box.location.z;
+
+	cmd.xRot = box.rotation.x;
+	cmd.yRot = box.rotation.y;
+	cmd.zRot = box.rotation.z;
+
+	cmd.width = box.scale.x;
+	cmd.height = box.scale.y;
+	cmd.depth = box.scale.z;
+
+	cmd.maxHits = maxHits;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_QUERY_OVERLAP_BOX;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_QUERY_OVERLAP_BOX_SZ;
+}
+
+///
+/// @brief Encode closest hitbox query command
+///
+/// @param buf 		Destination of command
+/// @param requestId 	Number identifying the query's results
+/// @param point 	Location to search from
+/// @param maxDistance 	Search radius
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeQueryClosest(
+	void* buf,
+	IgniHitRequestId requestId,
+	IgniVec3 point,
+	float maxDistance
+)
+{
+	IgniHitCmdQueryClosest cmd;
+	cmd.requestId = requestId;
+	cmd.xLoc = point.x;
+	cmd.yLoc = point.y;
+	cmd.zLoc = point.z;
+	cmd.maxDistance = maxDistance;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_QUERY_CLOSEST;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_QUERY_CLOSEST_SZ;
+}
+
+///
+/// @brief Encode hitbox collision filter command
+///
+/// @param buf 		Destination of command
+/// @param id 		Hitbox identification number
+/// @param layers 	Layers the hitbox occupies
+/// @param mask 	Layers the hitbox interacts with
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeHitboxSetFilter(
+	void* buf,
+	IgniHitElementId id,
+	IgniHitLayerMask layers,
+	IgniHitLayerMask mask
+)
+{
+	IgniHitCmdHitboxSetFilter cmd;
+	cmd.hitboxId = id;
+	cmd.layers = layers;
+	cmd.mask = mask;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_HITBOX_SET_FILTER;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_HITBOX_SET_FILTER_SZ;
+}
+
+///
+/// @brief Encode header of compressed command block
+///
+/// \note
+/// - The compressed data is expected to follow the header already, at
+///   IGNI_HIT_COMPRESSED_SZ bytes from the start of the command.
+///
+/// @param buf 		Destination of command
+/// @param rawLen 	Size of the commands before compression
+/// @param dataLen 	Size of the compressed data
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeCompressed(
+	void* buf,
+	uint32_t rawLen,
+	uint32_t dataLen
+)
+{
+	IgniHitCmdCompressed cmd;
+	cmd.rawLen = rawLen;
+	cmd.dataLen = dataLen;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_COMPRESSED;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_COMPRESSED_SZ + dataLen;
+}
+
+///
+/// @brief Encode hitbox parenting command
+///
+/// @param buf 		Destination of command
+/// @param id 		Hitbox identification number
+/// @param parentId 	Parent hitbox identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeHitboxSetParent(
+	void* buf,
+	IgniHitElementId id,
+	IgniHitElementId parentId
+)
+{
+	IgniHitCmdHitboxSetParent cmd;
+	cmd.hitboxId = id;
+	cmd.parentId = parentId;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_HITBOX_SET_PARENT;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_HITBOX_SET_PARENT_SZ;
+}
+
+///
+/// @brief Encode shaped hitbox creation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Hitbox identification number
+/// @param shape 	Geometry of hitbox
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeHitboxCreateShaped(
+	void* buf,
+	IgniHitElementId id,
+	IgniHitShape shape
+)
+{
+	IgniHitCmdHitboxCreateShaped cmd;
+	cmd.hitboxId = id;
+	cmd.shape = shape;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_HITBOX_CREATE_SHAPED;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_HITBOX_CREATE_SHAPED_SZ;
+}
+
+///
+/// @brief Encode sphere hitbox transformation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Hitbox identification number
+/// @param centre 	Location of sphere
+/// @param radius 	Radius of sphere
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeHitboxTransformSphere(
+	void* buf,
+	IgniHitElementId id,
+	IgniVec3 centre,
+	float radius
+)
+{
+	IgniHitCmdHitboxTransformSphere cmd;
+	cmd.hitboxId = id;
+	cmd.xLoc = centre.x;
+	cmd.yLoc = centre.y;
+	cmd.zLoc = centre.z;
+	cmd.radius = radius;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_HITBOX_TRANSFORM_SPHERE;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_HITBOX_TRANSFORM_SPHERE_SZ;
+}
+
+///
+/// @brief Encode capsule hitbox transformation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Hitbox identification number
+/// @param a 		First end of capsule segment
+/// @param b 		Second end of capsule segment
+/// @param radius 	Radius of capsule
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniHitEncodeHitboxTransformCapsule(
+	void* buf,
+	IgniHitElementId id,
+	IgniVec3 a,
+	IgniVec3 b,
+	float radius
+)
+{
+	IgniHitCmdHitboxTransformCapsule cmd;
+	cmd.hitboxId = id;
+
+	cmd.xA = a.x;
+	cmd.yA = a.y;
+	cmd.zA = a.z;
+
+	cmd.xB = b.x;
+	cmd.yB = b.y;
+	cmd.zB = b.z;
+
+	cmd.radius = radius;
+
+	*(uint8_t*)buf = IGNI_HIT_OP_HITBOX_TRANSFORM_CAPSULE;
+	memcpy((uint8_t*)buf + sizeof(IgniHitOpcode), &cmd, sizeof(cmd));
+	return IGNI_HIT_HITBOX_TRANSFORM_CAPSULE_SZ;
+}
+
+///
+/// @brief Layout of every hit command, indexed by opcode
+///
+extern const IgniOpcodeDesc igniHitOpcodes[256];
+
+///
+/// @brief Layout of every hit event, indexed by event number
+///
+extern const IgniOpcodeDesc igniHitEvents[256];
+
+///
+/// @brief Get size of the next command in a buffer of received bytes
+///
+/// @param buf 		Received bytes, starting at an opcode
+/// @param len 		Number of received bytes
+/// @return Size of command in bytes, as far as it can be told from len
+/// bytes. 0 if len is 0 or the opcode is unknown.
+///
+static inline size_t igniHitCmdSz(const void* buf, size_t len)
+{
+	return igniOpcodeSz(igniHitOpcodes, buf, len);
+}
+
+///
+/// @brief Get size of the next event in a buffer of received bytes
+///
+/// @param buf 		Received bytes, starting at an event number
+/// @param len 		Number of received bytes
+/// @return Size of event in bytes, as far as it can be told from len
+/// bytes. 0 if len is 0 or the event number is unknown.
+///
+static inline size_t igniHitEventSz(const void* buf, size_t len)
+{
+	return igniOpcodeSz(igniHitEvents, buf, len);
+}
+
+///
+/// @brief Open new Igni Hit connection
+///
+/// \note
+/// - The server socket is named by the environment variable IGNI_HIT_SRV.
+///
+/// @return Non-negative file descriptor. -1 if an error occurred.
+///
+int igniHitOpen();
+
+///
+/// @brief Open new Igni Hit connection to a given server
+///
+/// @param endpoint 	Pathname of server socket, or tcp://host:port
+/// @return Non-negative file descriptor. -1 if an error occurred.
+///
+int igniHitOpenAt(const char* endpoint);
+
 /// 
 /// @brief Add hitbox to scene
 ///
@@ -125,6 +815,179 @@ int igniHitHitboxDelete(
 	IgniHitElementId id
 );
 
+///
+/// @brief Cast a ray through the scene
+///
+/// \note
+/// - Results arrive as IGNI_HIT_EVENT_QUERY_RESULTS events carrying
+///   requestId. Any number of queries may be in flight at once.
+///
+/// @param fd 		File descriptor of server socket
+/// @param requestId 	Number identifying the query's results
+/// @param origin 	Start of ray
+/// @param dir 		Direction of ray
+/// @param maxDistance 	Length of ray
+/// @param maxHits 	Maximum number of hitboxes to report
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitQueryRaycast(
+	int fd,
+	IgniHitRequestId requestId,
+	IgniVec3 origin,
+	IgniVec3 dir,
+	float maxDistance,
+	uint16_t maxHits
+);
+
+///
+/// @brief Find hitboxes intersecting an oriented box
+///
+/// @param fd 		File descriptor of server socket
+/// @param requestId 	Number identifying the query's results
+/// @param box 		Location, rotation and dimensions of box
+/// @param maxHits 	Maximum number of hitboxes to report
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitQueryOverlapBox(
+	int fd,
+	IgniHitRequestId requestId,
+	IgniTransform box,
+	uint16_t maxHits
+);
+
+///
+/// @brief Find the hitbox closest to a point
+///
+/// @param fd 		File descriptor of server socket
+/// @param requestId 	Number identifying the query's results
+/// @param point 	Location to search from
+/// @param maxDistance 	Search radius
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitQueryClosest(
+	int fd,
+	IgniHitRequestId requestId,
+	IgniVec3 point,
+	float maxDistance
+);
+
+///
+/// @brief Receive a single event from the server
+///
+/// \note
+/// - Blocks until the whole event has arrived.
+/// - A buffer of IGNI_HIT_QUERY_RESULTS_MAX_SZ bytes fits any event.
+///
+/// @param fd 		File descriptor of server socket
+/// @param buf 		Destination of event, starting with its event number
+/// @param bufSz 	Size of destination in bytes
+/// @return Size of event in bytes. 0 if the server closed the connection.
+/// -1 to indicate an error.
+///
+ssize_t igniHitEventRecv(
+	int fd,
+	void* buf,
+	size_t bufSz
+);
+
+///
+/// @brief Add hitbox to scene in the given collision layers
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Hitbox identification number
+/// @param layers 	Layers the hitbox occupies
+/// @param mask 	Layers the hitbox interacts with
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitHitboxCreateFiltered(
+	int fd,
+	IgniHitElementId id,
+	IgniHitLayerMask layers,
+	IgniHitLayerMask mask
+);
+
+///
+/// @brief Choose which hitboxes a hitbox interacts with
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Hitbox identification number
+/// @param layers 	Layers the hitbox occupies
+/// @param mask 	Layers the hitbox interacts with
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitHitboxSetFilter(
+	int fd,
+	IgniHitElementId id,
+	IgniHitLayerMask layers,
+	IgniHitLayerMask mask
+);
+
+///
+/// @brief Make a hitbox's transform relative to another hitbox
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Hitbox identification number
+/// @param parentId 	Parent hitbox identification number, or
+/// 			IGNI_HIT_NULL_ELEMENT to detach the hitbox
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitHitboxSetParent(
+	int fd,
+	IgniHitElementId id,
+	IgniHitElementId parentId
+);
+
+///
+/// @brief Add hitbox of a given shape to scene
+///
+/// \note
+/// - Spheres and capsules are tested far more cheaply than boxes. Prefer
+///   them for characters and projectiles.
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Hitbox identification number
+/// @param shape 	Geometry of hitbox
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitHitboxCreateShaped(
+	int fd,
+	IgniHitElementId id,
+	IgniHitShape shape
+);
+
+///
+/// @brief Set location and radius of a sphere hitbox
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Hitbox identification number
+/// @param centre 	Location of sphere
+/// @param radius 	Radius of sphere
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitHitboxTransformSphere(
+	int fd,
+	IgniHitElementId id,
+	IgniVec3 centre,
+	float radius
+);
+
+///
+/// @brief Set segment and radius of a capsule hitbox
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Hitbox identification number
+/// @param a 		First end of capsule segment
+/// @param b 		Second end of capsule segment
+/// @param radius 	Radius of capsule
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniHitHitboxTransformCapsule(
+	int fd,
+	IgniHitElementId id,
+	IgniVec3 a,
+	IgniVec3 b,
+	float radius
+);
 
 #endif
 
@@ -0,0 +1,141 @@
+#ifndef _LIBIGNI_INTERNAL_H
+#define _LIBIGNI_INTERNAL_H 1
+
+/* Declarations shared between library sources but not installed. */
+
+#include "conn.h"
+#include "types.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Connection groups (group.c) */
+
+int igniGroupIs(int fd);
+
+int igniGroupSetNonBlocking(
+	int fd,
+	size_t queueSz,
+	IgniConnFlags flags
+);
+
+int igniGroupSend(
+	int fd,
+	const void* buf,
+	size_t len,
+	IgniConnMergeKey key
+);
+
+ssize_t igniGroupFlush(int fd);
+
+size_t igniGroupPending(int fd);
+
+int igniGroupForEach(
+	int fd,
+	int (*fn)(int shard, int arg),
+	int arg
+);
+
+/* Stream compression (compress.c) */
+
+/* Compress bytes into an LZ4 block. Returns the size of the block, or 0 if
+ * it would not fit in dstCap bytes. */
+size_t igniCompress(
+	const uint8_t* src,
+	size_t len,
+	uint8_t* dst,
+	size_t dstCap
+);
+
+/* io_uring submission (uring.c) */
+
+/* Completions are told apart by the descriptor and operation packed into
+ * their user data. */
+enum {
+	IGNI_URING_WRITE = 1,
+	IGNI_URING_RECV,
+	IGNI_URING_CANCEL
+};
+
+#define IGNI_URING_DATA(fd, op) (((uint64_t)(uint32_t)(fd) << 8) | (op))
+#define IGNI_URING_FD(data) ((int)(uint32_t)((data) >> 8))
+#define IGNI_URING_OP(data) ((int)((data) & 0xff))
+
+/* Set up the ring shared by all connections, if not done already. Fails
+ * with ENOSYS if io_uring is unavailable. */
+int igniUringSetup(void);
+
+/* Register a buffer for fixed writes to a TCP socket. Returns its index, or
+ * -1 if writes from it have to go without. */
+int igniUringRegister(void* buf, size_t len);
+
+void igniUringUnregister(int index);
+
+/* The following queue one operation each, failing with EBUSY if the
+ * submission queue is full. Nothing reaches the kernel until the next
+ * igniUringSubmit(). A bufIndex of -1 writes from an unregistered
+ * buffer. */
+
+int igniUringWrite(
+	int fd,
+	const void* buf,
+	size_t len,
+	int bufIndex,
+	uint64_t data
+);
+
+int igniUringRecv(
+	int fd,
+	void* buf,
+	size_t len,
+	int flags,
+	uint64_t data
+);
+
+int igniUringCancel(uint64_t target);
+
+/* Turn a queued operation that has not reached the kernel yet into a no-op.
+ * Returns 1 if there was one, 0 if it was submitted already. */
+int igniUringDiscard(uint64_t data);
+
+/* Submit queued operations, waiting for at least one completion if wait
+ * is non-zero. */
+int igniUringSubmit(int wait);
+
+/* Flags of a completion */
+enum {
+	/* Another completion of the same operation follows */
+	IGNI_URING_MORE = 1 << 0,
+
+	/* Carries no result, only ends an operation which had one before */
+	IGNI_URING_NOTIF = 1 << 1
+};
+
+/* Take one completion. Returns 1 if there was one, 0 otherwise. */
+int igniUringReap(uint64_t* data, int32_t* res, unsigned* flags);
+
+/* Connections (conn.c) */
+
+/* Tell a connection which protocol it speaks, so that frame headers can
+ * count the commands in them and merge barriers can be kept per element.
+ * Gives the connection state if it has none. */
+void igniConnSetOpcodes(int fd, const IgniOpcodeDesc* opcodes);
+
+/* Whether 'count' unmergeable commands of 'len' bytes in total can be sent
+ * without any of them failing with EAGAIN */
+int igniConnHasRoom(
+	int fd,
+	size_t len,
+	size_t count
+);
+
+/* Receive from a connection, through its io_uring if it has one */
+ssize_t igniConnRecv(
+	int fd,
+	void* buf,
+	size_t len,
+	int flags
+);
+
+#endif
+
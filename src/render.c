@@ -1,43 +1,133 @@
 #include "render.h"
+#include "conn.h"
+#include "internal.h"
 #include <stdio.h> 			/* printf(), perror() */
-#include <sys/socket.h> 	/* send() */
-#include <sys/un.h>			/* sockaddr_un */
+#include <errno.h> 			/* errno */
 #include <stdlib.h> 		/* getenv(), malloc(), free() */
+#include <stddef.h> 		/* offsetof() */
+#include <string.h> 		/* strlen() */
 #include <linux/limits.h> 	/* PATH_MAX */
 
+/* Command layouts are derived from the same structures and sizes as the
+ * encoders in render.h, so the two cannot disagree. */
+
+#define FIXED(sz) { \
+	.fixedSz = (sz), \
+	.version = IGNI_RENDER_VERSION \
+}
+
+#define VARIABLE(sz, type, countField, elemSz_) { \
+	.fixedSz = (sz), \
+	.countOffset = sizeof(IgniRndOpcode) + offsetof(type, countField), \
+	.countSz = sizeof(((type*)0)->countField), \
+	.version = IGNI_RENDER_VERSION, \
+	.elemSz = (elemSz_) \
+}
+
+const IgniOpcodeDesc igniRndOpcodes[256] = {
+	[IGNI_RENDER_OP_CONFIGURE] = FIXED(IGNI_RENDER_CONFIGURE_SZ),
+
+	[IGNI_RENDER_OP_MESH_CREATE] = VARIABLE(
+		IGNI_RENDER_MESH_CREATE_SZ,
+		IgniRndCmdMeshCreate,
+		pathLen,
+		1
+	),
+	[IGNI_RENDER_OP_MESH_SET_SHADER] = FIXED(IGNI_RENDER_MESH_SET_SHADER_SZ),
+	[IGNI_RENDER_OP_MESH_BIND_TEXTURE] =
+		FIXED(IGNI_RENDER_MESH_BIND_TEXTURE_SZ),
+	[IGNI_RENDER_OP_MESH_TRANSFORM] = FIXED(IGNI_RENDER_MESH_TRANSFORM_SZ),
+	[IGNI_RENDER_OP_MESH_DELETE] = FIXED(IGNI_RENDER_MESH_DELETE_SZ),
+
+	[IGNI_RENDER_OP_POINT_LIGHT_CREATE] =
+		FIXED(IGNI_RENDER_POINT_LIGHT_CREATE_SZ),
+	[IGNI_RENDER_OP_POINT_LIGHT_TRANSFORM] =
+		FIXED(IGNI_RENDER_POINT_LIGHT_TRANSFORM_SZ),
+	[IGNI_RENDER_OP_POINT_LIGHT_SET_COLOUR] =
+		FIXED(IGNI_RENDER_POINT_LIGHT_SET_COLOUR_SZ),
+	[IGNI_RENDER_OP_POINT_LIGHT_DELETE] =
+		FIXED(IGNI_RENDER_POINT_LIGHT_DELETE_SZ),
+
+	[IGNI_RENDER_OP_TEXTURE_CREATE] = VARIABLE(
+		IGNI_RENDER_TEXTURE_CREATE_SZ,
+		IgniRndCmdTextureCreate,
+		pathLen,
+		1
+	),
+	[IGNI_RENDER_OP_TEXTURE_DELETE] = FIXED(IGNI_RENDER_TEXTURE_DELETE_SZ),
+
+	[IGNI_RENDER_OP_VIEWPOINT_TRANSFORM] =
+		FIXED(IGNI_RENDER_VIEWPOINT_TRANSFORM_SZ),
+
+	[IGNI_RENDER_OP_BUNDLE_LOAD] = VARIABLE(
+		IGNI_RENDER_BUNDLE_LOAD_SZ,
+		IgniRndCmdBundleLoad,
+		pathLen,
+		1
+	),
+
+	[IGNI_RENDER_OP_TEXTURE_STREAM_CREATE] =
+		FIXED(IGNI_RENDER_TEXTURE_STREAM_CREATE_SZ),
+	[IGNI_RENDER_OP_TEXTURE_STREAM_LEVEL] = VARIABLE(
+		IGNI_RENDER_TEXTURE_STREAM_LEVEL_SZ,
+		IgniRndCmdTextureStreamLevel,
+		dataLen,
+		1
+	),
+	[IGNI_RENDER_OP_TEXTURE_STREAM_PRIORITY] =
+		FIXED(IGNI_RENDER_TEXTURE_STREAM_PRIORITY_SZ),
+	[IGNI_RENDER_OP_TEXTURE_STREAM_CANCEL] =
+		FIXED(IGNI_RENDER_TEXTURE_STREAM_CANCEL_SZ),
+
+	[IGNI_RENDER_OP_ELEMENT_SET_PARENT] =
+		FIXED(IGNI_RENDER_ELEMENT_SET_PARENT_SZ),
+
+	[IGNI_RENDER_OP_MESH_INSTANCE_CREATE] =
+		FIXED(IGNI_RENDER_MESH_INSTANCE_CREATE_SZ),
+	[IGNI_RENDER_OP_MESH_TRANSFORM_BATCH] = VARIABLE(
+		IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ,
+		IgniRndCmdMeshTransformBatch,
+		count,
+		sizeof(IgniRndTransformRecord)
+	),
+
+	[IGNI_RENDER_OP_COMPRESSED] = VARIABLE(
+		IGNI_RENDER_COMPRESSED_SZ,
+		IgniRndCmdCompressed,
+		dataLen,
+		1
+	)
+};
+
 int igniRndOpen()
 {
-	/* The Igni renderer recieves data through a UNIX domain socket. */
-
-	char* socketPath = getenv("IGNI_RENDER_SRV");
+	char* endpoint = getenv("IGNI_RENDER_SRV");
 
-	if (!socketPath) {
+	if (!endpoint) {
 		printf("Could not find environment variable 'IGNI_RENDER_SRV'.\n");
 		return -1;
 	}
 
-	struct sockaddr_un svAddr;
-	svAddr.sun_family = AF_UNIX;
-	strncpy(svAddr.sun_path, socketPath, sizeof(svAddr.sun_path));
+	return igniRndOpenAt(endpoint);
+}
 
-	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
-	if (connect(fd, (struct sockaddr*)&svAddr, sizeof(svAddr)) == -1) {
-		perror("Failed to connect to server");
+int igniRndOpenAt(const char* endpoint)
+{
+	int fd = igniConnConnect(endpoint);
+	if (fd == -1) {
+		return -1;
 	}
 
-	/* The new connection tells the server about itself. */
+	igniConnSetOpcodes(fd, igniRndOpcodes);
 
-	struct ConfigureCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdConfigure cmd;
-	};
+	/* The new connection tells the server about itself. */
 
-	struct ConfigureCmd configureCmd = {};
-	configureCmd.opcode = IGNI_RENDER_OP_CONFIGURE;
-	configureCmd.cmd.majVersion = 0;
+	uint8_t configure[IGNI_RENDER_CONFIGURE_SZ];
+	size_t configureSz = igniRndEncodeConfigure(configure, IGNI_RENDER_VERSION);
 
-	if (send(fd, &configureCmd, sizeof(configureCmd), 0) == -1) {
-		perror("send() in igniRndOpen() failed");
+	if (igniConnSend(fd, configure, configureSz, IGNI_CONN_NO_MERGE) == -1) {
+		perror("send() in igniRndOpenAt() failed");
+		igniConnClose(fd);
 		return -1;
 	}
 
@@ -47,7 +137,7 @@ int igniRndOpen()
 /* One-time commands 
  *
  * All the following functions work similarly: 
- * Step 1. Generate a packet from parameters given. 
+ * Step 1. Encode a packet from parameters given (see render.h). 
  * Step 2. Send the packet to the server. 
  * Step 3. Return */
 
@@ -57,33 +147,33 @@ int igniRndMeshCreate(
 	const char* path
 )
 {
-	struct MeshCreateCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdMeshCreate cmd;
-	};
-
 	/* PATH_MAX could be some crazy large number so it's best to store this
-	 * on the stack. */
+	 * on the heap. */
 
-	struct MeshCreateCmd* meshCreate;
-	meshCreate = malloc(sizeof(struct MeshCreateCmd) + PATH_MAX);
+	char* absPath = malloc(PATH_MAX);
 
-	meshCreate->opcode = IGNI_RENDER_OP_MESH_CREATE;
-	meshCreate->cmd.meshId = id;
-	if (!realpath(path, meshCreate->cmd.path)) {
+	if (!realpath(path, absPath)) {
 		perror("realpath() in igniRndMeshCreate() failed");
-		free(meshCreate);
+		free(absPath);
+		return -1;
+	}
+
+	size_t pathLen = strlen(absPath);
+	if (pathLen > UINT8_MAX) {
+		printf("Path '%s' is too long to send to the server.\n", absPath);
+		free(absPath);
 		return -1;
 	}
-	meshCreate->cmd.pathLen = strlen(meshCreate->cmd.path);
-	size_t meshCreateSz = sizeof(*meshCreate) + meshCreate->cmd.pathLen;
 
-	int sendResult = send(fd, meshCreate, meshCreateSz, 0);
+	uint8_t cmd[IGNI_RENDER_MESH_CREATE_MAX_SZ];
+	size_t cmdSz = igniRndEncodeMeshCreate(cmd, id, absPath, pathLen);
 
-	free(meshCreate);
+	free(absPath);
 
-	if (sendResult == -1) {
-		perror("send() in igniRndMeshCreate() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndMeshCreate() failed");
+		}
 		return -1;
 	}
 
@@ -97,18 +187,13 @@ int igniRndMeshSetShader(
 	IgniRndShader shader
 )
 {
-	struct MeshSetShaderCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdMeshSetShader cmd;
-	};
-
-	struct MeshSetShaderCmd meshSetShader = {};
-	meshSetShader.opcode = IGNI_RENDER_OP_MESH_SET_SHADER;
-	meshSetShader.cmd.meshId = id;
-	meshSetShader.cmd.shader = shader;
+	uint8_t cmd[IGNI_RENDER_MESH_SET_SHADER_SZ];
+	size_t cmdSz = igniRndEncodeMeshSetShader(cmd, id, shader);
 
-	if (send(fd, &meshSetShader, sizeof(meshSetShader), 0) == -1) {
-		perror("send() in igniRndMeshSetShader() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndMeshSetShader() failed");
+		}
 		return -1;
 	}
 
@@ -123,18 +208,18 @@ int igniRndMeshBindTexture(
 	IgniRndTextureTarget target
 )
 {
-	struct MeshBindTextureCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdMeshBindTexture cmd;
-	};
-
-	struct MeshBindTextureCmd meshBindTexture = {};
-	meshBindTexture.opcode = IGNI_RENDER_OP_MESH_BIND_TEXTURE;
-	meshBindTexture.cmd.textureId = texId;
-	meshBindTexture.cmd.meshId = meshId;
-
-	if (send(fd, &meshBindTexture, sizeof(meshBindTexture), 0) == -1) {
-		perror("send() in igniRndMeshBindTexture() failed");
+	uint8_t cmd[IGNI_RENDER_MESH_BIND_TEXTURE_SZ];
+	size_t cmdSz = igniRndEncodeMeshBindTexture(
+		cmd,
+		meshId,
+		texId,
+		target
+	);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndMeshBindTexture() failed");
+		}
 		return -1;
 	}
 
@@ -148,29 +233,15 @@ int igniRndMeshTransform(
 	IgniTransform tf
 )
 {
-	struct MeshTransformCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdMeshTransform cmd;
-	};
-
-	struct MeshTransformCmd meshTransform = {};
-	meshTransform.opcode = IGNI_RENDER_OP_MESH_TRANSFORM;
-	meshTransform.cmd.meshId = id;
-
-	meshTransform.cmd.xLoc = tf.location.x;
-	meshTransform.cmd.yLoc = tf.location.y;
-	meshTransform.cmd.zLoc = tf.location.z;
-	
-	meshTransform.cmd.xRot = tf.rotation.x;
-	meshTransform.cmd.yRot = tf.rotation.y;
-	meshTransform.cmd.zRot = tf.rotation.z;
-
-	meshTransform.cmd.xScale = tf.scale.x;
-	meshTransform.cmd.yScale = tf.scale.y;
-	meshTransform.cmd.zScale = tf.scale.z;
-
-	if (send(fd, &meshTransform, sizeof(meshTransform), 0) == -1) {
-		perror("send() in igniRndMeshTransform() failed");
+	uint8_t cmd[IGNI_RENDER_MESH_TRANSFORM_SZ];
+	size_t cmdSz = igniRndEncodeMeshTransform(cmd, id, tf);
+	IgniConnMergeKey key;
+	key = IGNI_CONN_MERGE_KEY(IGNI_RENDER_OP_MESH_TRANSFORM, id);
+
+	if (igniConnSend(fd, cmd, cmdSz, key) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndMeshTransform() failed");
+		}
 		return -1;
 	}
 
@@ -183,17 +254,13 @@ int igniRndMeshDelete(
 	IgniRndElementId id
 )
 {
-	struct MeshDeleteCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdMeshDelete cmd;
-	};
-
-	struct MeshDeleteCmd meshDelete = {};
-	meshDelete.opcode = IGNI_RENDER_OP_MESH_DELETE;
-	meshDelete.cmd.meshId = id;
+	uint8_t cmd[IGNI_RENDER_MESH_DELETE_SZ];
+	size_t cmdSz = igniRndEncodeMeshDelete(cmd, id);
 
-	if (send(fd, &meshDelete, sizeof(meshDelete), 0) == -1) {
-		perror("send() in igniRndMeshDelete() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndMeshDelete() failed");
+		}
 		return -1;
 	}
 
@@ -206,17 +273,13 @@ int igniRndPointLightCreate(
 	IgniRndElementId id
 )
 {
-	struct PointLightCreateCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdPointLightCreate cmd;
-	};
+	uint8_t cmd[IGNI_RENDER_POINT_LIGHT_CREATE_SZ];
+	size_t cmdSz = igniRndEncodePointLightCreate(cmd, id);
 
-	struct PointLightCreateCmd pointLightCreate = {};
-	pointLightCreate.opcode = IGNI_RENDER_OP_POINT_LIGHT_CREATE;
-	pointLightCreate.cmd.pointLightId = id;
-
-	if (send(fd, &pointLightCreate, sizeof(pointLightCreate), 0) == -1) {
-		perror("send() in igniRndPointLightCreate() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndPointLightCreate() failed");
+		}
 		return -1;
 	}
 
@@ -230,20 +293,15 @@ int igniRndPointLightTransform(
 	IgniVec3 tf
 )
 {
-	struct PointLightTransformCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdPointLightTransform cmd;
-	};
-
-	struct PointLightTransformCmd pointLightTransform = {};
-	pointLightTransform.opcode = IGNI_RENDER_OP_POINT_LIGHT_TRANSFORM;
-	pointLightTransform.cmd.pointLightId = id;
-	pointLightTransform.cmd.xLoc = tf.x;
-	pointLightTransform.cmd.yLoc = tf.y;
-	pointLightTransform.cmd.zLoc = tf.z;
-
-	if (send(fd, &pointLightTransform, sizeof(pointLightTransform), 0) == -1) {
-		perror("send() in igniRndPointLightTransform() failed");
+	uint8_t cmd[IGNI_RENDER_POINT_LIGHT_TRANSFORM_SZ];
+	size_t cmdSz = igniRndEncodePointLightTransform(cmd, id, tf);
+	IgniConnMergeKey key;
+	key = IGNI_CONN_MERGE_KEY(IGNI_RENDER_OP_POINT_LIGHT_TRANSFORM, id);
+
+	if (igniConnSend(fd, cmd, cmdSz, key) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndPointLightTransform() failed");
+		}
 		return -1;
 	}
 
@@ -257,20 +315,13 @@ int igniRndPointLightSetColour(
 	IgniVec3 colour
 )
 {
-	struct PointLightSetColour {
-		IgniRndOpcode opcode;
-		IgniRndCmdPointLightSetColour cmd;
-	};
+	uint8_t cmd[IGNI_RENDER_POINT_LIGHT_SET_COLOUR_SZ];
+	size_t cmdSz = igniRndEncodePointLightSetColour(cmd, id, colour);
 
-	struct PointLightSetColour pointLightSetColour = {};
-	pointLightSetColour.opcode = IGNI_RENDER_OP_POINT_LIGHT_SET_COLOUR;
-	pointLightSetColour.cmd.pointLightId = id;
-	pointLightSetColour.cmd.r = colour.r;
-	pointLightSetColour.cmd.g = colour.g;
-	pointLightSetColour.cmd.b = colour.b;
-
-	if (send(fd, &pointLightSetColour, sizeof(pointLightSetColour), 0) == -1) {
-		perror("send() in igniRndPointLightSetColour() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndPointLightSetColour() failed");
+		}
 		return -1;
 	}
 
@@ -283,17 +334,13 @@ int igniRndPointLightDelete(
 	IgniRndElementId id
 )
 {
-	struct PointLightDeleteCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdPointLightDelete cmd;
-	};
-	
-	struct PointLightDeleteCmd pointLightDelete = {};
-	pointLightDelete.opcode = IGNI_RENDER_OP_POINT_LIGHT_DELETE;
-	pointLightDelete.cmd.pointLightId = id;
+	uint8_t cmd[IGNI_RENDER_POINT_LIGHT_DELETE_SZ];
+	size_t cmdSz = igniRndEncodePointLightDelete(cmd, id);
 
-	if (send(fd, &pointLightDelete, sizeof(pointLightDelete), 0) == -1) {
-		perror("send() in igniRndPointLightDelete() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndPointLightDelete() failed");
+		}
 		return -1;
 	}
 
@@ -307,31 +354,33 @@ int igniRndTextureCreate(
 	const char* path
 )
 {
-	struct createTextureCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdTextureCreate cmd;
-	};
-
-	struct createTextureCmd* createTex;
-	createTex = malloc(sizeof(struct createTextureCmd) + PATH_MAX);
+	/* PATH_MAX could be some crazy large number so it's best to store this
+	 * on the heap. */
 
-	createTex->opcode = IGNI_RENDER_OP_TEXTURE_CREATE;
-	createTex->cmd.textureId = id;
+	char* absPath = malloc(PATH_MAX);
 
-	if (!realpath(path, createTex->cmd.path)) {
+	if (!realpath(path, absPath)) {
 		perror("realpath() in igniRndTextureCreate() failed");
-		free(createTex);
+		free(absPath);
 		return -1;
 	}
-	createTex->cmd.pathLen = strlen(createTex->cmd.path);
-	size_t texCreateSz = sizeof(*createTex) + createTex->cmd.pathLen;
 
-	int sendResult = send(fd, createTex, texCreateSz, 0);
+	size_t pathLen = strlen(absPath);
+	if (pathLen > UINT8_MAX) {
+		printf("Path '%s' is too long to send to the server.\n", absPath);
+		free(absPath);
+		return -1;
+	}
 
-	free(createTex);
+	uint8_t cmd[IGNI_RENDER_TEXTURE_CREATE_MAX_SZ];
+	size_t cmdSz = igniRndEncodeTextureCreate(cmd, id, absPath, pathLen);
 
-	if (sendResult == -1) {
-		perror("send() in igniRndTextureCreate() failed");
+	free(absPath);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndTextureCreate() failed");
+		}
 		return -1;
 	}
 
@@ -344,17 +393,13 @@ int igniRndTextureDelete(
 	IgniRndElementId id
 )
 {
-	struct deleteTextureCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdTextureDelete cmd;
-	};
+	uint8_t cmd[IGNI_RENDER_TEXTURE_DELETE_SZ];
+	size_t cmdSz = igniRndEncodeTextureDelete(cmd, id);
 
-	struct deleteTextureCmd deleteTex = {};
-	deleteTex.opcode = IGNI_RENDER_OP_TEXTURE_DELETE;
-	deleteTex.cmd.textureId = id;
-
-	if (send(fd, &deleteTex, sizeof(deleteTex), 0) == -1) {
-		perror("send() in igniRndTextureDelete() failed");
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndTextureDelete() failed");
+		}
 		return -1;
 	}
 
@@ -368,25 +413,89 @@ int igniRndViewpointTransform(
 	float fov
 )
 {
-	struct tfViewpointCmd {
-		IgniRndOpcode opcode;
-		IgniRndCmdViewpointTransform cmd;
-	};
+	uint8_t cmd[IGNI_RENDER_VIEWPOINT_TRANSFORM_SZ];
+	size_t cmdSz = igniRndEncodeViewpointTransform(cmd, tf, fov);
+	IgniConnMergeKey key;
+	key = IGNI_CONN_MERGE_KEY(IGNI_RENDER_OP_VIEWPOINT_TRANSFORM, 0);
+
+	if (igniConnSend(fd, cmd, cmdSz, key) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndViewpointTransform() failed");
+		}
+		return -1;
+	}
 
-	struct tfViewpointCmd tfViewpoint = {};
-	tfViewpoint.opcode = IGNI_RENDER_OP_VIEWPOINT_TRANSFORM;	
-	tfViewpoint.cmd.fov = fov;
-	
-	tfViewpoint.cmd.xLoc = tf.location.x;
-	tfViewpoint.cmd.yLoc = tf.location.y;
-	tfViewpoint.cmd.zLoc = tf.location.z;
+	return 0;
+}
+
+
+int igniRndBundleLoad(
+	int fd,
+	const char* path
+)
+{
+	/* PATH_MAX could be some crazy large number so it's best to store this
+	 * on the heap. */
+
+	char* absPath = malloc(PATH_MAX);
+
+	if (!realpath(path, absPath)) {
+		perror("realpath() in igniRndBundleLoad() failed");
+		free(absPath);
+		return -1;
+	}
+
+	size_t pathLen = strlen(absPath);
+	if (pathLen > UINT8_MAX) {
+		printf("Path '%s' is too long to send to the server.\n", absPath);
+		free(absPath);
+		return -1;
+	}
+
+	uint8_t cmd[IGNI_RENDER_BUNDLE_LOAD_MAX_SZ];
+	size_t cmdSz = igniRndEncodeBundleLoad(cmd, absPath, pathLen);
+
+	free(absPath);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndBundleLoad() failed");
+		}
+		return -1;
+	}
 
-	tfViewpoint.cmd.xLook = tf.lookAt.x;
-	tfViewpoint.cmd.yLook = tf.lookAt.y;
-	tfViewpoint.cmd.zLook = tf.lookAt.z;
+	return 0;
+}
 
-	if (send(fd, &tfViewpoint, sizeof(tfViewpoint), 0) == -1) {
-		perror("send() in igniRndViewpointTransform() failed");
+
+int igniRndTextureStreamCreate(
+	int fd,
+	IgniRndElementId id,
+	uint32_t width,
+	uint32_t height,
+	IgniRndTextureFormat format,
+	uint8_t levelCount
+)
+{
+	if (!igniRndTextureLevelSz(width, height, format, 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	uint8_t cmd[IGNI_RENDER_TEXTURE_STREAM_CREATE_SZ];
+	size_t cmdSz = igniRndEncodeTextureStreamCreate(
+		cmd,
+		id,
+		width,
+		height,
+		format,
+		levelCount
+	);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndTextureStreamCreate() failed");
+		}
 		return -1;
 	}
 
@@ -394,3 +503,174 @@ int igniRndViewpointTransform(
 }
 
 
+int igniRndTextureStreamLevel(
+	int fd,
+	IgniRndElementId id,
+	uint32_t width,
+	uint32_t height,
+	IgniRndTextureFormat format,
+	uint8_t level,
+	const void* data,
+	uint32_t dataLen
+)
+{
+	size_t levelSz = igniRndTextureLevelSz(width, height, format, level);
+
+	if (!levelSz || dataLen != levelSz) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Level data can be megabytes in size, so the command is built on the
+	 * heap. It has to be sent as a single piece, or a non-blocking
+	 * connection could accept the header and then refuse the pixels. */
+
+	uint8_t* cmd = malloc(IGNI_RENDER_TEXTURE_STREAM_LEVEL_SZ + dataLen);
+	if (!cmd) {
+		perror("malloc() in igniRndTextureStreamLevel() failed");
+		return -1;
+	}
+
+	size_t cmdSz = igniRndEncodeTextureStreamLevel(
+		cmd,
+		id,
+		level,
+		data,
+		dataLen
+	);
+
+	int sendResult = igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE);
+
+	free(cmd);
+
+	if (sendResult == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndTextureStreamLevel() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int igniRndTextureStreamPriority(
+	int fd,
+	IgniRndElementId id,
+	float priority
+)
+{
+	uint8_t cmd[IGNI_RENDER_TEXTURE_STREAM_PRIORITY_SZ];
+	size_t cmdSz = igniRndEncodeTextureStreamPriority(cmd, id, priority);
+	IgniConnMergeKey key;
+	key = IGNI_CONN_MERGE_KEY(IGNI_RENDER_OP_TEXTURE_STREAM_PRIORITY, id);
+
+	if (igniConnSend(fd, cmd, cmdSz, key) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndTextureStreamPriority() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int igniRndTextureStreamCancel(
+	int fd,
+	IgniRndElementId id
+)
+{
+	uint8_t cmd[IGNI_RENDER_TEXTURE_STREAM_CANCEL_SZ];
+	size_t cmdSz = igniRndEncodeTextureStreamCancel(cmd, id);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndTextureStreamCancel() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int igniRndElementSetParent(
+	int fd,
+	IgniRndElementType childType,
+	IgniRndElementId childId,
+	IgniRndElementType parentType,
+	IgniRndElementId parentId
+)
+{
+	uint8_t cmd[IGNI_RENDER_ELEMENT_SET_PARENT_SZ];
+	size_t cmdSz = igniRndEncodeElementSetParent(
+		cmd,
+		childType,
+		childId,
+		parentType,
+		parentId
+	);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndElementSetParent() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int igniRndMeshInstanceCreate(
+	int fd,
+	IgniRndElementId id,
+	IgniRndElementId sourceId
+)
+{
+	uint8_t cmd[IGNI_RENDER_MESH_INSTANCE_CREATE_SZ];
+	size_t cmdSz = igniRndEncodeMeshInstanceCreate(cmd, id, sourceId);
+
+	if (igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE) == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndMeshInstanceCreate() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int igniRndMeshTransformBatch(
+	int fd,
+	IgniRndElementId firstId,
+	const IgniTransform* tfs,
+	uint32_t count
+)
+{
+	size_t cmdCap = IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ +
+		(size_t)count * sizeof(IgniRndTransformRecord);
+
+	uint8_t* cmd = malloc(cmdCap);
+	if (!cmd) {
+		perror("malloc() in igniRndMeshTransformBatch() failed");
+		return -1;
+	}
+
+	size_t cmdSz = igniRndEncodeMeshTransformBatch(cmd, firstId, tfs, count);
+
+	int sendResult = igniConnSend(fd, cmd, cmdSz, IGNI_CONN_NO_MERGE);
+
+	free(cmd);
+
+	if (sendResult == -1) {
+		if (errno != EAGAIN) {
+			perror("send() in igniRndMeshTransformBatch() failed");
+		}
+		return -1;
+	}
+
+	return 0;
+}
@@ -8,6 +8,8 @@
 
 #include "types.h"
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 
 /// 
 /// @brief Command number
@@ -31,7 +33,23 @@ enum {
 	IGNI_RENDER_OP_TEXTURE_CREATE,
 	IGNI_RENDER_OP_TEXTURE_DELETE,
 
-	IGNI_RENDER_OP_VIEWPOINT_TRANSFORM
+	IGNI_RENDER_OP_VIEWPOINT_TRANSFORM,
+
+	IGNI_RENDER_OP_BUNDLE_LOAD,
+
+	IGNI_RENDER_OP_TEXTURE_STREAM_CREATE,
+	IGNI_RENDER_OP_TEXTURE_STREAM_LEVEL,
+	IGNI_RENDER_OP_TEXTURE_STREAM_PRIORITY,
+	IGNI_RENDER_OP_TEXTURE_STREAM_CANCEL,
+
+	IGNI_RENDER_OP_ELEMENT_SET_PARENT,
+
+	IGNI_RENDER_OP_MESH_INSTANCE_CREATE,
+	IGNI_RENDER_OP_MESH_TRANSFORM_BATCH,
+
+	/* Kept apart from the other commands so that both protocols frame
+	 * compressed blocks the same way. */
+	IGNI_RENDER_OP_COMPRESSED = 0xff
 };
 
 /// 
@@ -163,6 +181,893 @@ typedef struct {
 	float fov;
 }__attribute__((packed)) IgniRndCmdViewpointTransform;
 
+///
+/// @brief Load every element stored in a scene bundle file
+///
+/// \note
+/// - The bundle format is described in bundle.h.
+///
+typedef struct {
+	uint8_t pathLen;
+	char path[];
+}__attribute__((packed)) IgniRndCmdBundleLoad;
+
+///
+/// @brief Pixel layout of streamed texture data
+///
+typedef uint8_t IgniRndTextureFormat;
+enum {
+	IGNI_RENDER_TEXTURE_FORMAT_RGBA8 = 0,
+	IGNI_RENDER_TEXTURE_FORMAT_RGB8,
+	IGNI_RENDER_TEXTURE_FORMAT_R8,
+
+	IGNI_RENDER_TEXTURE_FORMAT_COUNT
+};
+
+///
+/// @brief Declare texture whose mip levels are sent separately
+///
+/// \note
+/// - Level 0 is the full size image. Each following level halves both
+///   dimensions, rounding down to no less than one pixel.
+/// - The texture can be bound as soon as it is declared and is sampled at
+///   the finest level received so far.
+///
+typedef struct {
+	IgniRndElementId textureId;
+	uint32_t width;
+	uint32_t height;
+	IgniRndTextureFormat format;
+	uint8_t levelCount;
+}__attribute__((packed)) IgniRndCmdTextureStreamCreate;
+
+///
+/// @brief Supply pixels of one mip level of a streamed texture
+///
+/// \note
+/// - Rows are tightly packed, top row first.
+///
+typedef struct {
+	IgniRndElementId textureId;
+	uint8_t level;
+	uint32_t dataLen;
+	uint8_t data[];
+}__attribute__((packed)) IgniRndCmdTextureStreamLevel;
+
+///
+/// @brief Set order in which the server uploads pending levels
+///
+/// \note
+/// - Levels of textures with higher priority are uploaded first.
+///
+typedef struct {
+	IgniRndElementId textureId;
+	float priority;
+}__attribute__((packed)) IgniRndCmdTextureStreamPriority;
+
+///
+/// @brief Discard levels of a streamed texture that are not yet uploaded
+///
+/// \note
+/// - The texture keeps the levels already uploaded. Further levels may
+///   still be sent afterwards.
+///
+typedef struct {
+	IgniRndElementId textureId;
+}__attribute__((packed)) IgniRndCmdTextureStreamCancel;
+
+///
+/// @brief Sequence of whole commands compressed as one LZ4 block
+///
+/// \note
+/// - Sent by connections with compression enabled, see
+///   igniConnSetCompression().
+/// - data holds dataLen bytes which decompress to rawLen bytes of
+///   commands.
+///
+typedef struct {
+	uint32_t rawLen;
+	uint32_t dataLen;
+	uint8_t data[];
+}__attribute__((packed)) IgniRndCmdCompressed;
+
+///
+/// @brief Kind of scene element
+///
+typedef uint8_t IgniRndElementType;
+enum {
+	IGNI_RENDER_ELEMENT_MESH = 0,
+	IGNI_RENDER_ELEMENT_POINT_LIGHT,
+
+	IGNI_RENDER_ELEMENT_TYPE_COUNT
+};
+
+///
+/// @brief Attach element to a parent element
+///
+/// \note
+/// - Transforms sent for the child afterwards are relative to the parent,
+///   and the child follows every later transform of the parent.
+/// - A parentId of IGNI_RENDER_NULL_ELEMENT detaches the child, whose
+///   transforms become world-space again.
+/// - Point lights have no rotation or scale of their own, but may still
+///   be parents.
+///
+typedef struct {
+	IgniRndElementId childId;
+	IgniRndElementId parentId;
+	IgniRndElementType childType;
+	IgniRndElementType parentType;
+}__attribute__((packed)) IgniRndCmdElementSetParent;
+
+///
+/// @brief Add mesh sharing the geometry and material of a loaded mesh
+///
+/// \note
+/// - The new mesh is an ordinary mesh element with a transform of its
+///   own. Instances of one source are drawn together in a single batch.
+/// - Shader and texture changes to the source apply to all its instances.
+///
+typedef struct {
+	IgniRndElementId meshId;
+	IgniRndElementId sourceMeshId;
+}__attribute__((packed)) IgniRndCmdMeshInstanceCreate;
+
+///
+/// @brief Location, rotation and scale of one mesh in a transform batch
+///
+typedef struct {
+	float xLoc, yLoc, zLoc;
+	float xRot, yRot, zRot;
+	float xScale, yScale, zScale;
+}__attribute__((packed)) IgniRndTransformRecord;
+
+///
+/// @brief Adjust location, rotation and scale of consecutive meshes
+///
+/// \note
+/// - transforms[i] applies to mesh firstMeshId + i.
+///
+typedef struct {
+	IgniRndElementId firstMeshId;
+	uint32_t count;
+	IgniRndTransformRecord transforms[];
+}__attribute__((packed)) IgniRndCmdMeshTransformBatch;
+
+/* Command encoders
+ *
+ * The following functions write a single command, opcode included, into
+ * memory provided by the caller and return the number of bytes written.
+ * They are defined here so that they can be inlined into the caller,
+ * which may place commands in any buffer it likes before sending them.
+ *
+ * The destination must hold at least IGNI_RENDER_*_SZ bytes, or
+ * IGNI_RENDER_*_MAX_SZ bytes for commands ending in a pathname. It needs
+ * no particular alignment. */
+
+_Static_assert(sizeof(IgniRndCmdConfigure) == 1, "IgniRndCmdConfigure");
+_Static_assert(sizeof(IgniRndCmdMeshCreate) == 5, "IgniRndCmdMeshCreate");
+_Static_assert(sizeof(IgniRndCmdMeshSetShader) == 5, "IgniRndCmdMeshSetShader");
+_Static_assert(
+	sizeof(IgniRndCmdMeshBindTexture) == 9,
+	"IgniRndCmdMeshBindTexture"
+);
+_Static_assert(
+	sizeof(IgniRndCmdMeshTransform) == 40,
+	"IgniRndCmdMeshTransform"
+);
+_Static_assert(sizeof(IgniRndCmdMeshDelete) == 4, "IgniRndCmdMeshDelete");
+_Static_assert(
+	sizeof(IgniRndCmdPointLightCreate) == 4,
+	"IgniRndCmdPointLightCreate"
+);
+_Static_assert(
+	sizeof(IgniRndCmdPointLightTransform) == 16,
+	"IgniRndCmdPointLightTransform"
+);
+_Static_assert(
+	sizeof(IgniRndCmdPointLightSetColour) == 16,
+	"IgniRndCmdPointLightSetColour"
+);
+_Static_assert(
+	sizeof(IgniRndCmdPointLightDelete) == 4,
+	"IgniRndCmdPointLightDelete"
+);
+_Static_assert(sizeof(IgniRndCmdTextureCreate) == 5, "IgniRndCmdTextureCreate");
+_Static_assert(sizeof(IgniRndCmdTextureDelete) == 4, "IgniRndCmdTextureDelete");
+_Static_assert(
+	sizeof(IgniRndCmdViewpointTransform) == 28,
+	"IgniRndCmdViewpointTransform"
+);
+_Static_assert(sizeof(IgniRndCmdBundleLoad) == 1, "IgniRndCmdBundleLoad");
+_Static_assert(
+	sizeof(IgniRndCmdTextureStreamCreate) == 14,
+	"IgniRndCmdTextureStreamCreate"
+);
+_Static_assert(
+	sizeof(IgniRndCmdTextureStreamLevel) == 9,
+	"IgniRndCmdTextureStreamLevel"
+);
+_Static_assert(
+	sizeof(IgniRndCmdTextureStreamPriority) == 8,
+	"IgniRndCmdTextureStreamPriority"
+);
+_Static_assert(
+	sizeof(IgniRndCmdTextureStreamCancel) == 4,
+	"IgniRndCmdTextureStreamCancel"
+);
+_Static_assert(sizeof(IgniRndCmdCompressed) == 8, "IgniRndCmdCompressed");
+_Static_assert(
+	sizeof(IgniRndCmdElementSetParent) == 10,
+	"IgniRndCmdElementSetParent"
+);
+_Static_assert(
+	sizeof(IgniRndCmdMeshInstanceCreate) == 8,
+	"IgniRndCmdMeshInstanceCreate"
+);
+_Static_assert(sizeof(IgniRndTransformRecord) == 36, "IgniRndTransformRecord");
+_Static_assert(
+	sizeof(IgniRndTransformRecord) == sizeof(IgniTransform),
+	"IgniTransform can be copied into a transform batch as is"
+);
+_Static_assert(
+	sizeof(IgniRndCmdMeshTransformBatch) == 8,
+	"IgniRndCmdMeshTransformBatch"
+);
+
+#define IGNI_RENDER_CMD_SZ(type) (sizeof(IgniRndOpcode) + sizeof(type))
+
+#define IGNI_RENDER_CONFIGURE_SZ IGNI_RENDER_CMD_SZ(IgniRndCmdConfigure)
+#define IGNI_RENDER_MESH_CREATE_SZ IGNI_RENDER_CMD_SZ(IgniRndCmdMeshCreate)
+#define IGNI_RENDER_MESH_CREATE_MAX_SZ (IGNI_RENDER_MESH_CREATE_SZ + UINT8_MAX)
+#define IGNI_RENDER_MESH_SET_SHADER_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdMeshSetShader)
+#define IGNI_RENDER_MESH_BIND_TEXTURE_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdMeshBindTexture)
+#define IGNI_RENDER_MESH_TRANSFORM_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdMeshTransform)
+#define IGNI_RENDER_MESH_DELETE_SZ IGNI_RENDER_CMD_SZ(IgniRndCmdMeshDelete)
+#define IGNI_RENDER_POINT_LIGHT_CREATE_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdPointLightCreate)
+#define IGNI_RENDER_POINT_LIGHT_TRANSFORM_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdPointLightTransform)
+#define IGNI_RENDER_POINT_LIGHT_SET_COLOUR_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdPointLightSetColour)
+#define IGNI_RENDER_POINT_LIGHT_DELETE_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdPointLightDelete)
+#define IGNI_RENDER_TEXTURE_CREATE_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdTextureCreate)
+#define IGNI_RENDER_TEXTURE_CREATE_MAX_SZ \
+	(IGNI_RENDER_TEXTURE_CREATE_SZ + UINT8_MAX)
+#define IGNI_RENDER_TEXTURE_DELETE_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdTextureDelete)
+#define IGNI_RENDER_VIEWPOINT_TRANSFORM_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdViewpointTransform)
+#define IGNI_RENDER_BUNDLE_LOAD_SZ IGNI_RENDER_CMD_SZ(IgniRndCmdBundleLoad)
+#define IGNI_RENDER_BUNDLE_LOAD_MAX_SZ (IGNI_RENDER_BUNDLE_LOAD_SZ + UINT8_MAX)
+#define IGNI_RENDER_TEXTURE_STREAM_CREATE_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdTextureStreamCreate)
+#define IGNI_RENDER_TEXTURE_STREAM_LEVEL_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdTextureStreamLevel)
+#define IGNI_RENDER_TEXTURE_STREAM_PRIORITY_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdTextureStreamPriority)
+#define IGNI_RENDER_TEXTURE_STREAM_CANCEL_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdTextureStreamCancel)
+#define IGNI_RENDER_COMPRESSED_SZ IGNI_RENDER_CMD_SZ(IgniRndCmdCompressed)
+#define IGNI_RENDER_ELEMENT_SET_PARENT_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdElementSetParent)
+#define IGNI_RENDER_MESH_INSTANCE_CREATE_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdMeshInstanceCreate)
+#define IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ \
+	IGNI_RENDER_CMD_SZ(IgniRndCmdMeshTransformBatch)
+
+///
+/// @brief Encode connection configuration command
+///
+/// @param buf 		Destination of command
+/// @param majVersion 	Major protocol version used by the client
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeConfigure(void* buf, uint8_t majVersion)
+{
+	IgniRndCmdConfigure cmd = {};
+	cmd.majVersion = majVersion;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_CONFIGURE;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_CONFIGURE_SZ;
+}
+
+///
+/// @brief Encode mesh creation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Mesh identification number
+/// @param path 	Absolute mesh pathname, not null-terminated
+/// @param pathLen 	Length of pathname in bytes
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeMeshCreate(
+	void* buf,
+	IgniRndElementId id,
+	const char* path,
+	uint8_t pathLen
+)
+{
+	IgniRndCmdMeshCreate cmd = {};
+	cmd.meshId = id;
+	cmd.pathLen = pathLen;
+
+	uint8_t* dst = (uint8_t*)buf;
+	*dst = IGNI_RENDER_OP_MESH_CREATE;
+	memcpy(dst + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	memcpy(dst + IGNI_RENDER_MESH_CREATE_SZ, path, pathLen);
+	return IGNI_RENDER_MESH_CREATE_SZ + pathLen;
+}
+
+///
+/// @brief Encode mesh shading mode command
+///
+/// @param buf 		Destination of command
+/// @param id 		Mesh identification number
+/// @param shader 	Shader type to apply
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeMeshSetShader(
+	void* buf,
+	IgniRndElementId id,
+	IgniRndShader shader
+)
+{
+	IgniRndCmdMeshSetShader cmd = {};
+	cmd.meshId = id;
+	cmd.shader = shader;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_MESH_SET_SHADER;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_MESH_SET_SHADER_SZ;
+}
+
+///
+/// @brief Encode mesh texture binding command
+///
+/// @param buf 		Destination of command
+/// @param meshId 	Mesh identification number
+/// @param texId 	Texture identification number
+/// @param target 	G-buffer which the texture affects
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeMeshBindTexture(
+	void* buf,
+	IgniRndElementId meshId,
+	IgniRndElementId texId,
+	IgniRndTextureTarget target
+)
+{
+	IgniRndCmdMeshBindTexture cmd = {};
+	cmd.meshId = meshId;
+	cmd.textureId = texId;
+	cmd.target = target;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_MESH_BIND_TEXTURE;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_MESH_BIND_TEXTURE_SZ;
+}
+
+///
+/// @brief Encode mesh transformation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Mesh identification number
+/// @param tf		New transformation of mesh
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeMeshTransform(
+	void* buf,
+	IgniRndElementId id,
+	IgniTransform tf
+)
+{
+	IgniRndCmdMeshTransform cmd;
+	cmd.meshId = id;
+
+	cmd.xLoc = tf.location.x;
+	cmd.yLoc = tf.location.y;
+	cmd.zLoc = tf.location.z;
+
+	cmd.xRot = tf.rotation.x;
+	cmd.yRot = tf.rotation.y;
+	cmd.zRot = tf.rotation.z;
+
+	cmd.xScale = tf.scale.x;
+	cmd.yScale = tf.scale.y;
+	cmd.zScale = tf.scale.z;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_MESH_TRANSFORM;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_MESH_TRANSFORM_SZ;
+}
+
+///
+/// @brief Encode mesh removal command
+///
+/// @param buf 		Destination of command
+/// @param id 		Mesh identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeMeshDelete(void* buf, IgniRndElementId id)
+{
+	IgniRndCmdMeshDelete cmd;
+	cmd.meshId = id;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_MESH_DELETE;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_MESH_DELETE_SZ;
+}
+
+///
+/// @brief Encode point light creation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Point light identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodePointLightCreate(
+	void* buf,
+	IgniRndElementId id
+)
+{
+	IgniRndCmdPointLightCreate cmd;
+	cmd.pointLightId = id;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_POINT_LIGHT_CREATE;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_POINT_LIGHT_CREATE_SZ;
+}
+
+///
+/// @brief Encode point light location command
+///
+/// @param buf 		Destination of command
+/// @param id 		Point light identification number
+/// @param tf 		New location of point light
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodePointLightTransform(
+	void* buf,
+	IgniRndElementId id,
+	IgniVec3 tf
+)
+{
+	IgniRndCmdPointLightTransform cmd;
+	cmd.pointLightId = id;
+	cmd.xLoc = tf.x;
+	cmd.yLoc = tf.y;
+	cmd.zLoc = tf.z;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_POINT_LIGHT_TRANSFORM;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_POINT_LIGHT_TRANSFORM_SZ;
+}
+
+///
+/// @brief Encode point light colour command
+///
+/// @param buf 		Destination of command
+/// @param id 		Point light identification number
+/// @param colour 	New colour of point light
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodePointLightSetColour(
+	void* buf,
+	IgniRndElementId id,
+	IgniVec3 colour
+)
+{
+	IgniRndCmdPointLightSetColour cmd;
+	cmd.pointLightId = id;
+	cmd.r = colour.r;
+	cmd.g = colour.g;
+	cmd.b = colour.b;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_POINT_LIGHT_SET_COLOUR;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_POINT_LIGHT_SET_COLOUR_SZ;
+}
+
+///
+/// @brief Encode point light removal command
+///
+/// @param buf 		Destination of command
+/// @param id 		Point light identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodePointLightDelete(
+	void* buf,
+	IgniRndElementId id
+)
+{
+	IgniRndCmdPointLightDelete cmd;
+	cmd.pointLightId = id;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_POINT_LIGHT_DELETE;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_POINT_LIGHT_DELETE_SZ;
+}
+
+///
+/// @brief Encode texture creation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Texture identification number
+/// @param path 	Absolute image pathname, not null-terminated
+/// @param pathLen 	Length of pathname in bytes
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeTextureCreate(
+	void* buf,
+	IgniRndElementId id,
+	const char* path,
+	uint8_t pathLen
+)
+{
+	IgniRndCmdTextureCreate cmd = {};
+	cmd.textureId = id;
+	cmd.pathLen = pathLen;
+
+	uint8_t* dst = (uint8_t*)buf;
+	*dst = IGNI_RENDER_OP_TEXTURE_CREATE;
+	memcpy(dst + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	memcpy(dst + IGNI_RENDER_TEXTURE_CREATE_SZ, path, pathLen);
+	return IGNI_RENDER_TEXTURE_CREATE_SZ + pathLen;
+}
+
+///
+/// @brief Encode texture removal command
+///
+/// @param buf 		Destination of command
+/// @param id 		Texture identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeTextureDelete(void* buf, IgniRndElementId id)
+{
+	IgniRndCmdTextureDelete cmd;
+	cmd.textureId = id;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_TEXTURE_DELETE;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_TEXTURE_DELETE_SZ;
+}
+
+///
+/// @brief Encode viewpoint placement command
+///
+/// @param buf 		Destination of command
+/// @param tf 		Viewpoint location and look
+/// @param fov 		Field of view in radians
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeViewpointTransform(
+	void* buf,
+	IgniViewTransform tf,
+	float fov
+)
+{
+	IgniRndCmdViewpointTransform cmd;
+
+	cmd.xLoc = tf.location.x;
+	cmd.yLoc = tf.location.y;
+	cmd.zLoc = tf.location.z;
+
+	cmd.xLook = tf.lookAt.x;
+	cmd.yLook = tf.lookAt.y;
+	cmd.zLook = tf.lookAt.z;
+
+	cmd.fov = fov;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_VIEWPOINT_TRANSFORM;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_VIEWPOINT_TRANSFORM_SZ;
+}
+
+///
+/// @brief Encode scene bundle loading command
+///
+/// @param buf 		Destination of command
+/// @param path 	Absolute bundle pathname, not null-terminated
+/// @param pathLen 	Length of pathname in bytes
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeBundleLoad(
+	void* buf,
+	const char* path,
+	uint8_t pathLen
+)
+{
+	IgniRndCmdBundleLoad cmd = {};
+	cmd.pathLen = pathLen;
+
+	uint8_t* dst = (uint8_t*)buf;
+	*dst = IGNI_RENDER_OP_BUNDLE_LOAD;
+	memcpy(dst + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	memcpy(dst + IGNI_RENDER_BUNDLE_LOAD_SZ, path, pathLen);
+	return IGNI_RENDER_BUNDLE_LOAD_SZ + pathLen;
+}
+
+///
+/// @brief Get size in bytes of one mip level of a streamed texture
+///
+/// @param width 	Width of level 0 in pixels
+/// @param height 	Height of level 0 in pixels
+/// @param format 	Pixel layout
+/// @param level 	Mip level
+/// @return Size of level data in bytes. 0 if the format is unknown.
+///
+static inline size_t igniRndTextureLevelSz(
+	uint32_t width,
+	uint32_t height,
+	IgniRndTextureFormat format,
+	uint8_t level
+)
+{
+	static const uint8_t pixelSz[IGNI_RENDER_TEXTURE_FORMAT_COUNT] = {
+		[IGNI_RENDER_TEXTURE_FORMAT_RGBA8] = 4,
+		[IGNI_RENDER_TEXTURE_FORMAT_RGB8] = 3,
+		[IGNI_RENDER_TEXTURE_FORMAT_R8] = 1
+	};
+
+	if ((unsigned)format >= IGNI_RENDER_TEXTURE_FORMAT_COUNT) {
+		return 0;
+	}
+
+	uint32_t levelWidth = level < 32 ? width >> level : 0;
+	uint32_t levelHeight = level < 32 ? height >> level : 0;
+
+	levelWidth += !levelWidth;
+	levelHeight += !levelHeight;
+
+	return (size_t)levelWidth * levelHeight * pixelSz[format];
+}
+
+///
+/// @brief Encode streamed texture declaration command
+///
+/// @param buf 		Destination of command
+/// @param id 		Texture identification number
+/// @param width 	Width of level 0 in pixels
+/// @param height 	Height of level 0 in pixels
+/// @param format 	Pixel layout
+/// @param levelCount 	Number of mip levels
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeTextureStreamCreate(
+	void* buf,
+	IgniRndElementId id,
+	uint32_t width,
+	uint32_t height,
+	IgniRndTextureFormat format,
+	uint8_t levelCount
+)
+{
+	IgniRndCmdTextureStreamCreate cmd;
+	cmd.textureId = id;
+	cmd.width = width;
+	cmd.height = height;
+	cmd.format = format;
+	cmd.levelCount = levelCount;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_TEXTURE_STREAM_CREATE;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_TEXTURE_STREAM_CREATE_SZ;
+}
+
+///
+/// @brief Encode streamed texture level command
+///
+/// \note
+/// - The destination must hold IGNI_RENDER_TEXTURE_STREAM_LEVEL_SZ bytes
+///   plus the level data.
+///
+/// @param buf 		Destination of command
+/// @param id 		Texture identification number
+/// @param level 	Mip level
+/// @param data 	Pixels of level
+/// @param dataLen 	Size of level data in bytes
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeTextureStreamLevel(
+	void* buf,
+	IgniRndElementId id,
+	uint8_t level,
+	const void* data,
+	uint32_t dataLen
+)
+{
+	IgniRndCmdTextureStreamLevel cmd;
+	cmd.textureId = id;
+	cmd.level = level;
+	cmd.dataLen = dataLen;
+
+	uint8_t* dst = (uint8_t*)buf;
+	*dst = IGNI_RENDER_OP_TEXTURE_STREAM_LEVEL;
+	memcpy(dst + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	memcpy(dst + IGNI_RENDER_TEXTURE_STREAM_LEVEL_SZ, data, dataLen);
+	return IGNI_RENDER_TEXTURE_STREAM_LEVEL_SZ + dataLen;
+}
+
+///
+/// @brief Encode streamed texture priority command
+///
+/// @param buf 		Destination of command
+/// @param id 		Texture identification number
+/// @param priority 	Upload priority
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeTextureStreamPriority(
+	void* buf,
+	IgniRndElementId id,
+	float priority
+)
+{
+	IgniRndCmdTextureStreamPriority cmd;
+	cmd.textureId = id;
+	cmd.priority = priority;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_TEXTURE_STREAM_PRIORITY;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_TEXTURE_STREAM_PRIORITY_SZ;
+}
+
+///
+/// @brief Encode streamed texture cancellation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Texture identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeTextureStreamCancel(
+	void* buf,
+	IgniRndElementId id
+)
+{
+	IgniRndCmdTextureStreamCancel cmd;
+	cmd.textureId = id;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_TEXTURE_STREAM_CANCEL;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_TEXTURE_STREAM_CANCEL_SZ;
+}
+
+///
+/// @brief Encode header of compressed command block
+///
+/// \note
+/// - The compressed data is expected to follow the header already, at
+///   IGNI_RENDER_COMPRESSED_SZ bytes from the start of the command.
+///
+/// @param buf 		Destination of command
+/// @param rawLen 	Size of the commands before compression
+/// @param dataLen 	Size of the compressed data
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeCompressed(
+	void* buf,
+	uint32_t rawLen,
+	uint32_t dataLen
+)
+{
+	IgniRndCmdCompressed cmd;
+	cmd.rawLen = rawLen;
+	cmd.dataLen = dataLen;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_COMPRESSED;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_COMPRESSED_SZ + dataLen;
+}
+
+///
+/// @brief Encode element parenting command
+///
+/// @param buf 		Destination of command
+/// @param childType 	Kind of child element
+/// @param childId 	Child identification number
+/// @param parentType 	Kind of parent element
+/// @param parentId 	Parent identification number
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeElementSetParent(
+	void* buf,
+	IgniRndElementType childType,
+	IgniRndElementId childId,
+	IgniRndElementType parentType,
+	IgniRndElementId parentId
+)
+{
+	IgniRndCmdElementSetParent cmd;
+	cmd.childId = childId;
+	cmd.parentId = parentId;
+	cmd.childType = childType;
+	cmd.parentType = parentType;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_ELEMENT_SET_PARENT;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_ELEMENT_SET_PARENT_SZ;
+}
+
+///
+/// @brief Encode mesh instance creation command
+///
+/// @param buf 		Destination of command
+/// @param id 		Mesh identification number of the instance
+/// @param sourceId 	Mesh whose geometry and material are shared
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeMeshInstanceCreate(
+	void* buf,
+	IgniRndElementId id,
+	IgniRndElementId sourceId
+)
+{
+	IgniRndCmdMeshInstanceCreate cmd;
+	cmd.meshId = id;
+	cmd.sourceMeshId = sourceId;
+
+	*(uint8_t*)buf = IGNI_RENDER_OP_MESH_INSTANCE_CREATE;
+	memcpy((uint8_t*)buf + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	return IGNI_RENDER_MESH_INSTANCE_CREATE_SZ;
+}
+
+///
+/// @brief Encode batched mesh transformation command
+///
+/// \note
+/// - The destination must hold IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ bytes
+///   plus count transform records.
+///
+/// @param buf 		Destination of command
+/// @param firstId 	Mesh identification number of the first transform
+/// @param tfs 		New transformations of consecutive meshes
+/// @param count 	Number of transformations
+/// @return Size of encoded command in bytes
+///
+static inline size_t igniRndEncodeMeshTransformBatch(
+	void* buf,
+	IgniRndElementId firstId,
+	const IgniTransform* tfs,
+	uint32_t count
+)
+{
+	IgniRndCmdMeshTransformBatch cmd;
+	cmd.firstMeshId = firstId;
+	cmd.count = count;
+
+	size_t tfsSz = (size_t)count * sizeof(IgniRndTransformRecord);
+
+	uint8_t* dst = (uint8_t*)buf;
+	*dst = IGNI_RENDER_OP_MESH_TRANSFORM_BATCH;
+	memcpy(dst + sizeof(IgniRndOpcode), &cmd, sizeof(cmd));
+	memcpy(dst + IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ, tfs, tfsSz);
+	return IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ + tfsSz;
+}
+
+///
+/// @brief Layout of every render command, indexed by opcode
+///
+extern const IgniOpcodeDesc igniRndOpcodes[256];
+
+///
+/// @brief Get size of the next command in a buffer of received bytes
+///
+/// @param buf 		Received bytes, starting at an opcode
+/// @param len 		Number of received bytes
+/// @return Size of command in bytes, as far as it can be told from len
+/// bytes. 0 if len is 0 or the opcode is unknown.
+///
+static inline size_t igniRndCmdSz(const void* buf, size_t len)
+{
+	return igniOpcodeSz(igniRndOpcodes, buf, len);
+}
+
 ///
 /// @brief Open new Igni Render connection
 ///
@@ -170,6 +1075,14 @@ typedef struct {
 ///
 int igniRndOpen();
 
+///
+/// @brief Open new Igni Render connection to a given server
+///
+/// @param endpoint 	Pathname of server socket, or tcp://host:port
+/// @return Non-negative file descriptor. -1 if an error occurred.
+///
+int igniRndOpenAt(const char* endpoint);
+
 ///
 /// @brief Load mesh from file
 ///
@@ -333,5 +1246,151 @@ int igniRndViewpointTransform(
 	float fov
 );
 
+///
+/// @brief Load scene bundle from file
+///
+/// @param fd 		File descriptor of server socket
+/// @param path 	Relative or absolute bundle pathname
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndBundleLoad(
+	int fd,
+	const char* path
+);
+
+///
+/// @brief Declare texture whose mip levels are sent separately
+///
+/// \note
+/// - Send levels with igniRndTextureStreamLevel(), smallest first, so
+///   that a coarse image is available as early as possible.
+/// - Remove the texture with igniRndTextureDelete().
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Texture identification number
+/// @param width 	Width of level 0 in pixels
+/// @param height 	Height of level 0 in pixels
+/// @param format 	Pixel layout
+/// @param levelCount 	Number of mip levels
+/// @return 0 upon success. -1 to indicate an error, with errno set to EINVAL
+///         if the format is unknown.
+///
+int igniRndTextureStreamCreate(
+	int fd,
+	IgniRndElementId id,
+	uint32_t width,
+	uint32_t height,
+	IgniRndTextureFormat format,
+	uint8_t levelCount
+);
+
+///
+/// @brief Send pixels of one mip level of a streamed texture
+///
+/// \note
+/// - On a non-blocking connection the outbound queue must be large enough
+///   to hold the whole level.
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Texture identification number
+/// @param width 	Width of level 0 in pixels, as declared
+/// @param height 	Height of level 0 in pixels, as declared
+/// @param format 	Pixel layout, as declared
+/// @param level 	Mip level
+/// @param data 	Pixels of level, igniRndTextureLevelSz() bytes long
+/// @param dataLen 	Size of level data in bytes
+/// @return 0 upon success. -1 to indicate an error, with errno set to EINVAL
+///         if the format is unknown or dataLen does not match the level.
+///
+int igniRndTextureStreamLevel(
+	int fd,
+	IgniRndElementId id,
+	uint32_t width,
+	uint32_t height,
+	IgniRndTextureFormat format,
+	uint8_t level,
+	const void* data,
+	uint32_t dataLen
+);
+
+///
+/// @brief Set order in which the server uploads pending levels
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Texture identification number
+/// @param priority 	Upload priority, higher first, e.g. inverse distance
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndTextureStreamPriority(
+	int fd,
+	IgniRndElementId id,
+	float priority
+);
+
+///
+/// @brief Discard levels of a streamed texture that are not yet uploaded
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Texture identification number
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndTextureStreamCancel(
+	int fd,
+	IgniRndElementId id
+);
+
+///
+/// @brief Make an element's transform relative to another element
+///
+/// @param fd 		File descriptor of server socket
+/// @param childType 	Kind of child element
+/// @param childId 	Child identification number
+/// @param parentType 	Kind of parent element
+/// @param parentId 	Parent identification number, or
+/// 			IGNI_RENDER_NULL_ELEMENT to detach the child
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndElementSetParent(
+	int fd,
+	IgniRndElementType childType,
+	IgniRndElementId childId,
+	IgniRndElementType parentType,
+	IgniRndElementId parentId
+);
+
+///
+/// @brief Add mesh sharing the geometry and material of a loaded mesh
+///
+/// @param fd 		File descriptor of server socket
+/// @param id 		Mesh identification number of the instance
+/// @param sourceId 	Mesh whose geometry and material are shared
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndMeshInstanceCreate(
+	int fd,
+	IgniRndElementId id,
+	IgniRndElementId sourceId
+);
+
+///
+/// @brief Set location, rotation and scale of consecutive meshes
+///
+/// \note
+/// - Giving instances consecutive IDs lets a whole crowd or forest be moved
+///   with one command.
+///
+/// @param fd 		File descriptor of server socket
+/// @param firstId 	Mesh identification number of the first transform
+/// @param tfs 		New transformations, tfs[i] applying to firstId + i
+/// @param count 	Number of transformations
+/// @return 0 upon success. -1 to indicate an error.
+///
+int igniRndMeshTransformBatch(
+	int fd,
+	IgniRndElementId firstId,
+	const IgniTransform* tfs,
+	uint32_t count
+);
+
 #endif
 
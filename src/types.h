@@ -1,6 +1,10 @@
 #ifndef _LIBIGNI_TYPES_H
 #define _LIBIGNI_TYPES_H 1
 
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
 typedef struct {
 	union {
 		float x;
@@ -29,5 +33,63 @@ typedef struct {
 	IgniVec3 lookAt;
 }__attribute__((packed)) IgniViewTransform;
 
+///
+/// @brief Wire layout of one command or event number
+///
+/// A command occupies fixedSz bytes, opcode included. Commands with a
+/// variable-length tail hold the number of elements in it as a countSz
+/// byte integer at countOffset, and each element is elemSz bytes.
+///
+/// \note
+/// - Unknown numbers have a fixedSz of 0.
+/// - version is the major protocol version that introduced the number.
+///
+typedef struct {
+	uint32_t fixedSz;
+	uint16_t countOffset;
+	uint8_t countSz;
+	uint8_t version;
+	uint32_t elemSz;
+} IgniOpcodeDesc;
+
+///
+/// @brief Get size of the next command or event in a buffer
+///
+/// Every number is sized the same way, by lookup, whether or not it has a
+/// variable-length tail. The first byte is enough to tell the size of the
+/// fixed part. The size of the tail is known once the fixed part is in the
+/// buffer, so a result larger than len may grow when called again with
+/// that many bytes.
+///
+/// @param descs 	Descriptor table indexed by command or event number
+/// @param buf 		Bytes starting at a command or event number
+/// @param len 		Number of bytes in buffer
+/// @return Size in bytes, as far as it can be told. 0 if the buffer is
+/// empty or the number is unknown.
+///
+static inline size_t igniOpcodeSz(
+	const IgniOpcodeDesc* descs,
+	const void* buf,
+	size_t len
+)
+{
+	const uint8_t* src = (const uint8_t*)buf;
+
+	if (!len) {
+		return 0;
+	}
+
+	const IgniOpcodeDesc* desc = &descs[src[0]];
+
+	if (len < desc->fixedSz || !desc->countSz) {
+		return desc->fixedSz;
+	}
+
+	uint32_t count = 0;
+	memcpy(&count, src + desc->countOffset, desc->countSz);
+
+	return desc->fixedSz + (size_t)count * desc->elemSz;
+}
+
 #endif
 
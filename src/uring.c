@@ -0,0 +1,574 @@
+#include "internal.h"
+#include "config.h"
+#include <errno.h> 			/* errno */
+
+/* The probe arrived in Linux 5.6 along with the rest of what the ring
+ * needs, short of registered buffers. */
+#if defined(HAVE_LINUX_IO_URING_H) && HAVE_DECL_IORING_REGISTER_PROBE
+
+#include <stdio.h> 			/* perror() */
+#include <stdlib.h> 		/* calloc(), free() */
+#include <string.h> 		/* memset() */
+#include <unistd.h> 		/* syscall(), close() */
+#include <sys/mman.h> 		/* mmap(), munmap() */
+#include <sys/socket.h> 	/* MSG_NOSIGNAL */
+#include <sys/syscall.h> 	/* __NR_io_uring_* */
+#include <sys/uio.h> 		/* iovec */
+#include <linux/io_uring.h>
+
+/* A single ring serves every connection of the process, so that one
+ * io_uring_enter() call can submit the writes of all of them and wait for
+ * a receive at the same time.
+ *
+ * The ring is driven with raw system calls rather than liburing, which
+ * keeps the library free of dependencies. */
+
+#define RING_ENTRIES 256
+
+/* Size of the sparse registered buffer table. Connections beyond this
+ * number are still served by the ring, just without registered buffers. */
+#define BUFFER_SLOTS 64
+
+/* Registered buffers are written through zero-copy sends, the only write
+ * operation which takes them together with MSG_NOSIGNAL. Headers older
+ * than Linux 6.0 leave them out. */
+#if \
+	HAVE_DECL_IORING_REGISTER_BUFFERS2 && \
+	HAVE_DECL_IORING_RSRC_REGISTER_SPARSE && \
+	HAVE_DECL_IORING_OP_SEND_ZC && \
+	HAVE_DECL_IORING_RECVSEND_FIXED_BUF && \
+	HAVE_DECL_IORING_CQE_F_NOTIF
+#define FIXED_SENDS 1
+#else
+#define FIXED_SENDS 0
+#endif
+
+static struct {
+	/* 0 until set up, 1 if the ring is usable, -1 if it is not */
+	int state;
+	int fd;
+
+	unsigned* sqHead;
+	unsigned* sqTail;
+	unsigned sqMask;
+	unsigned* sqArray;
+	struct io_uring_sqe* sqes;
+
+	/* Entries filled in but not yet passed to the kernel */
+	unsigned sqPending;
+
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned cqMask;
+	struct io_uring_cqe* cqes;
+
+	int fixed;
+	uint8_t slotUsed[BUFFER_SLOTS];
+} ring = { .fd = -1 };
+
+static int enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+	return syscall(
+		__NR_io_uring_enter,
+		ring.fd,
+		toSubmit,
+		minComplete,
+		flags,
+		NULL,
+		0
+	);
+}
+
+static int reg(unsigned opcode, void* arg, unsigned nrArgs)
+{
+	return syscall(__NR_io_uring_register, ring.fd, opcode, arg, nrArgs);
+}
+
+static int supports(const struct io_uring_probe* supported, uint8_t op)
+{
+	return
+		op <= supported->last_op &&
+		supported->ops[op].flags & IO_URING_OP_SUPPORTED;
+}
+
+/* Check that the kernel supports every operation the ring is used for.
+ * Kernels old enough to lack any of them also lack the probe itself.
+ * Zero-copy sends are optional, and decide whether buffers get
+ * registered. */
+static int probe(int* zeroCopy)
+{
+	static const uint8_t ops[] = {
+		IORING_OP_SEND,
+		IORING_OP_RECV,
+		IORING_OP_ASYNC_CANCEL
+	};
+
+	const unsigned opCount = 256;
+
+	struct io_uring_probe* supported = calloc(
+		1,
+		sizeof(*supported) + opCount * sizeof(struct io_uring_probe_op)
+	);
+
+	if (!supported) {
+		perror("calloc() in libigni io_uring setup failed");
+		return -1;
+	}
+
+	int result = reg(IORING_REGISTER_PROBE, supported, opCount);
+
+	for (size_t i = 0; result == 0 && i < sizeof(ops); ++i) {
+		if (!supports(supported, ops[i])) {
+			result = -1;
+		}
+	}
+
+#if FIXED_SENDS
+	*zeroCopy = result == 0 && supports(supported, IORING_OP_SEND_ZC);
+#else
+	*zeroCopy = 0;
+#endif
+
+	free(supported);
+	return result;
+}
+
+static int setup(void)
+{
+	struct io_uring_params params = {};
+	int zeroCopy;
+
+	ring.fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+	if (ring.fd == -1) {
+		return -1;
+	}
+
+	if (probe(&zeroCopy) == -1) {
+		close(ring.fd);
+		return -1;
+	}
+
+	size_t sqSz = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	size_t cqSz = params.cq_off.cqes +
+		params.cq_entries * sizeof(struct io_uring_cqe);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP && cqSz > sqSz) {
+		sqSz = cqSz;
+	}
+
+	uint8_t* sq = mmap(
+		NULL,
+		sqSz,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE,
+		ring.fd,
+		IORING_OFF_SQ_RING
+	);
+
+	if (sq == MAP_FAILED) {
+		perror("mmap() in libigni io_uring setup failed");
+		close(ring.fd);
+		return -1;
+	}
+
+	uint8_t* cq = sq;
+
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+		cq = mmap(
+			NULL,
+			cqSz,
+			PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE,
+			ring.fd,
+			IORING_OFF_CQ_RING
+		);
+
+		if (cq == MAP_FAILED) {
+			perror("mmap() in libigni io_uring setup failed");
+			munmap(sq, sqSz);
+			close(ring.fd);
+			return -1;
+		}
+	}
+
+	ring.sqes = mmap(
+		NULL,
+		params.sq_entries * sizeof(struct io_uring_sqe),
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE,
+		ring.fd,
+		IORING_OFF_SQES
+	);
+
+	if (ring.sqes == MAP_FAILED) {
+		perror("mmap() in libigni io_uring setup failed");
+		if (cq != sq) {
+			munmap(cq, cqSz);
+		}
+		munmap(sq, sqSz);
+		close(ring.fd);
+		return -1;
+	}
+
+	ring.sqHead = (unsigned*)(sq + params.sq_off.head);
+	ring.sqTail = (unsigned*)(sq + params.sq_off.tail);
+	ring.sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+	ring.sqArray = (unsigned*)(sq + params.sq_off.array);
+
+	ring.cqHead = (unsigned*)(cq + params.cq_off.head);
+	ring.cqTail = (unsigned*)(cq + params.cq_off.tail);
+	ring.cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	/* Registered buffers spare the kernel from pinning and mapping the
+	 * outbound queue on every write. Without them, plain sends are used. */
+
+#if FIXED_SENDS
+	struct io_uring_rsrc_register bufs = {};
+	bufs.nr = BUFFER_SLOTS;
+	bufs.flags = IORING_RSRC_REGISTER_SPARSE;
+
+	ring.fixed =
+		zeroCopy &&
+		reg(IORING_REGISTER_BUFFERS2, &bufs, sizeof(bufs)) == 0;
+#else
+	(void)zeroCopy;
+#endif
+
+	return 0;
+}
+
+int igniUringSetup(void)
+{
+	if (!ring.state) {
+		ring.state = setup() == 0 ? 1 : -1;
+	}
+
+	if (ring.state == -1) {
+		errno = ENOSYS;
+		return -1;
+	}
+
+	return 0;
+}
+
+#if FIXED_SENDS
+
+int igniUringRegister(void* buf, size_t len)
+{
+	if (!ring.fixed) {
+		return -1;
+	}
+
+	for (int i = 0; i < BUFFER_SLOTS; ++i) {
+		if (ring.slotUsed[i]) {
+			continue;
+		}
+
+		struct iovec iov = { buf, len };
+
+		struct io_uring_rsrc_update2 update = {};
+		update.offset = i;
+		update.data = (uintptr_t)&iov;
+		update.nr = 1;
+
+		/* Registration may fail for lack of lockable memory, in which case
+		 * the other slots will not do any better. */
+		if (reg(IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) < 0) {
+			return -1;
+		}
+
+		ring.slotUsed[i] = 1;
+		return i;
+	}
+
+	return -1;
+}
+
+void igniUringUnregister(int index)
+{
+	if (index < 0) {
+		return;
+	}
+
+	struct iovec iov = {};
+
+	struct io_uring_rsrc_update2 update = {};
+	update.offset = index;
+	update.data = (uintptr_t)&iov;
+	update.nr = 1;
+
+	reg(IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update));
+	ring.slotUsed[index] = 0;
+}
+
+#else
+
+int igniUringRegister(void* buf, size_t len)
+{
+	(void)buf;
+	(void)len;
+
+	return -1;
+}
+
+void igniUringUnregister(int index)
+{
+	(void)index;
+}
+
+#endif
+
+/* Get a cleared submission queue entry, or NULL if the queue is full. */
+static struct io_uring_sqe* getSqe(void)
+{
+	unsigned head = __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE);
+	unsigned tail = *ring.sqTail;
+
+	if (tail - head > ring.sqMask) {
+		return NULL;
+	}
+
+	unsigned index = tail & ring.sqMask;
+	struct io_uring_sqe* sqe = &ring.sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+
+	ring.sqArray[index] = index;
+	__atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+	++ring.sqPending;
+
+	return sqe;
+}
+
+int igniUringWrite(
+	int fd,
+	const void* buf,
+	size_t len,
+	int bufIndex,
+	uint64_t data
+)
+{
+	struct io_uring_sqe* sqe = getSqe();
+	if (!sqe) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t)buf;
+	sqe->len = len;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = data;
+
+#if FIXED_SENDS
+	if (bufIndex >= 0) {
+		sqe->opcode = IORING_OP_SEND_ZC;
+		sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+		sqe->buf_index = bufIndex;
+	}
+#else
+	(void)bufIndex;
+#endif
+
+	return 0;
+}
+
+int igniUringRecv(
+	int fd,
+	void* buf,
+	size_t len,
+	int flags,
+	uint64_t data
+)
+{
+	struct io_uring_sqe* sqe = getSqe();
+	if (!sqe) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t)buf;
+	sqe->len = len;
+	sqe->msg_flags = flags;
+	sqe->user_data = data;
+
+	return 0;
+}
+
+int igniUringCancel(uint64_t target)
+{
+	struct io_uring_sqe* sqe = getSqe();
+	if (!sqe) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = target;
+	sqe->user_data = IGNI_URING_DATA(-1, IGNI_URING_CANCEL);
+
+	return 0;
+}
+
+int igniUringDiscard(uint64_t data)
+{
+	unsigned tail = *ring.sqTail;
+
+	/* Entries past those the kernel has consumed are still ours. */
+	for (unsigned i = tail - ring.sqPending; i != tail; ++i) {
+		struct io_uring_sqe* sqe = &ring.sqes[ring.sqArray[i & ring.sqMask]];
+
+		if (sqe->user_data == data) {
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_NOP;
+			sqe->user_data = IGNI_URING_DATA(-1, IGNI_URING_CANCEL);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int igniUringSubmit(int wait)
+{
+	if (!ring.sqPending && !wait) {
+		return 0;
+	}
+
+	unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+	int submitted = enter(ring.sqPending, wait ? 1 : 0, flags);
+
+	if (submitted == -1) {
+		return -1;
+	}
+
+	ring.sqPending -= submitted;
+	return 0;
+}
+
+int igniUringReap(uint64_t* data, int32_t* res, unsigned* flags)
+{
+	unsigned head = *ring.cqHead;
+	unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+
+	if (head == tail) {
+		return 0;
+	}
+
+	struct io_uring_cqe* cqe = &ring.cqes[head & ring.cqMask];
+	*data = cqe->user_data;
+	*res = cqe->res;
+	*flags = 0;
+
+	/* Only zero-copy sends complete more than once. */
+#if FIXED_SENDS
+	if (cqe->flags & IORING_CQE_F_MORE) {
+		*flags |= IGNI_URING_MORE;
+	}
+
+	if (cqe->flags & IORING_CQE_F_NOTIF) {
+		*flags |= IGNI_URING_NOTIF;
+	}
+#endif
+
+	__atomic_store_n(ring.cqHead, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+#else
+
+/* Without io_uring headers, every connection falls back to plain sends and
+ * receives. Only igniUringSetup() is ever reached. */
+
+int igniUringSetup(void)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+int igniUringRegister(void* buf, size_t len)
+{
+	(void)buf;
+	(void)len;
+
+	return -1;
+}
+
+void igniUringUnregister(int index)
+{
+	(void)index;
+}
+
+int igniUringWrite(
+	int fd,
+	const void* buf,
+	size_t len,
+	int bufIndex,
+	uint64_t data
+)
+{
+	(void)fd;
+	(void)buf;
+	(void)len;
+	(void)bufIndex;
+	(void)data;
+
+	errno = ENOSYS;
+	return -1;
+}
+
+int igniUringRecv(
+	int fd,
+	void* buf,
+	size_t len,
+	int flags,
+	uint64_t data
+)
+{
+	(void)fd;
+	(void)buf;
+	(void)len;
+	(void)flags;
+	(void)data;
+
+	errno = ENOSYS;
+	return -1;
+}
+
+int igniUringCancel(uint64_t target)
+{
+	(void)target;
+
+	errno = ENOSYS;
+	return -1;
+}
+
+int igniUringDiscard(uint64_t data)
+{
+	(void)data;
+
+	return 0;
+}
+
+int igniUringSubmit(int wait)
+{
+	(void)wait;
+
+	errno = ENOSYS;
+	return -1;
+}
+
+int igniUringReap(uint64_t* data, int32_t* res, unsigned* flags)
+{
+	(void)data;
+	(void)res;
+	(void)flags;
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,279 @@
+#include "internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Every block igniCompress() produces must decode back to its input under
+ * the LZ4 block format, end-of-block rules included, which decoders such
+ * as LZ4_decompress_safe() enforce. The decoder below is written from the
+ * format description rather than taken from the library. */
+
+#define INPUT_MAX (65536 + 4096)
+
+/* The format wants the last 5 bytes to be literals, and the last match to
+ * start at least 12 bytes before the end. */
+#define LAST_LITERALS 5
+#define MF_LIMIT 12
+
+static int failures;
+static unsigned seed;
+
+static uint8_t input[INPUT_MAX];
+static uint8_t block[INPUT_MAX + INPUT_MAX / 255 + 64];
+static uint8_t output[INPUT_MAX];
+
+/* Read a length continuation. Returns -1 if the block ends within it. */
+static int readLen(const uint8_t** ip, const uint8_t* end, size_t* len)
+{
+	uint8_t b;
+
+	do {
+		if (*ip >= end) {
+			return -1;
+		}
+
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+
+	return 0;
+}
+
+/* Decode an LZ4 block. Returns the decoded size, or -1 if the block is
+ * malformed or breaks the end-of-block rules. */
+static long decompress(
+	const uint8_t* src,
+	size_t len,
+	uint8_t* dst,
+	size_t cap
+)
+{
+	const uint8_t* ip = src;
+	const uint8_t* end = src + len;
+	size_t out = 0;
+
+	size_t lastMatchStart = 0;
+	size_t lastMatchEnd = 0;
+	int matched = 0;
+
+	for (;;) {
+		if (ip >= end) {
+			return -1;
+		}
+
+		uint8_t token = *ip++;
+		size_t litLen = token >> 4;
+
+		if (litLen == 15 && readLen(&ip, end, &litLen) == -1) {
+			return -1;
+		}
+
+		if (litLen > (size_t)(end - ip) || litLen > cap - out) {
+			return -1;
+		}
+
+		memcpy(dst + out, ip, litLen);
+		ip += litLen;
+		out += litLen;
+
+		/* The last sequence is made of literals alone. */
+		if (ip == end) {
+			break;
+		}
+
+		if (end - ip < 2) {
+			return -1;
+		}
+
+		size_t offset = ip[0] | ip[1] << 8;
+		ip += 2;
+
+		if (!offset || offset > out) {
+			return -1;
+		}
+
+		size_t matchLen = token & 15;
+
+		if (matchLen == 15 && readLen(&ip, end, &matchLen) == -1) {
+			return -1;
+		}
+
+		matchLen += 4;
+
+		if (matchLen > cap - out) {
+			return -1;
+		}
+
+		lastMatchStart = out;
+		matched = 1;
+
+		/* A match may overlap the bytes it produces. */
+		for (size_t i = 0; i < matchLen; ++i, ++out) {
+			dst[out] = dst[out - offset];
+		}
+
+		lastMatchEnd = out;
+	}
+
+	if (
+		matched &&
+		(out - lastMatchEnd < LAST_LITERALS || out - lastMatchStart < MF_LIMIT)
+	) {
+		return -1;
+	}
+
+	return out;
+}
+
+static void check(const char* name, size_t len)
+{
+	size_t blockSz = igniCompress(input, len, block, sizeof(block));
+
+	/* Inputs too short to hold a match are not compressed at all. */
+	if (len <= MF_LIMIT) {
+		if (blockSz) {
+			printf("FAIL %s: %zu byte input compressed\n", name, len);
+			++failures;
+		}
+		return;
+	}
+
+	if (!blockSz) {
+		printf("FAIL %s: %zu bytes not compressed (seed %u)\n",
+			name, len, seed);
+		++failures;
+		return;
+	}
+
+	long outSz = decompress(block, blockSz, output, sizeof(output));
+
+	if (outSz != (long)len || memcmp(output, input, len)) {
+		printf(
+			"FAIL %s: %zu bytes decoded as %ld from a %zu byte block"
+			" (seed %u)\n",
+			name,
+			len,
+			outSz,
+			blockSz,
+			seed
+		);
+		++failures;
+		return;
+	}
+
+	/* A block one byte short of the one produced must be refused rather
+	 * than overrun. */
+	uint8_t guard = block[blockSz - 1] ^ 0x5a;
+	block[blockSz - 1] = guard;
+
+	if (igniCompress(input, len, block, blockSz - 1)) {
+		printf("FAIL %s: %zu bytes compressed into too small a block\n",
+			name, len);
+		++failures;
+	}
+
+	if (block[blockSz - 1] != guard) {
+		printf("FAIL %s: %zu bytes written past the block\n", name, len);
+		++failures;
+	}
+}
+
+static void fillRandomAt(size_t start, size_t len)
+{
+	for (size_t i = start; i < start + len; ++i) {
+		input[i] = rand();
+	}
+}
+
+static void fillRandom(size_t len)
+{
+	fillRandomAt(0, len);
+}
+
+/* Repeat a random pattern of the given period. */
+static void fillPeriodic(size_t len, size_t period)
+{
+	for (size_t i = 0; i < len; ++i) {
+		input[i] = i < period ? rand() : input[i - period];
+	}
+}
+
+/* Place random bytes twice, 'distance' apart, amid zeros. Nothing in
+ * between hashes like them, so the second copy finds the first. */
+static void fillDistant(size_t len, size_t distance)
+{
+	memset(input, 0, len);
+	fillRandomAt(1, 16);
+	memcpy(input + 1 + distance, input + 1, 16);
+}
+
+/* Transforms of a few meshes, much like a real command stream */
+static void fillCommands(size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		switch (i % 41) {
+		case 0:
+			input[i] = 4;
+			break;
+		case 1:
+			input[i] = rand() % 8;
+			break;
+		case 2: case 3: case 4:
+			input[i] = 0;
+			break;
+		default:
+			input[i] = i % 4 == 3 ? 0x3f : rand();
+		}
+	}
+}
+
+int main(void)
+{
+	seed = time(NULL);
+	srand(seed);
+
+	/* Every size around the end-of-block limits */
+	for (size_t len = 0; len <= 4 * MF_LIMIT; ++len) {
+		fillRandom(len);
+		check("random", len);
+
+		memset(input, 0, len);
+		check("zeros", len);
+
+		fillPeriodic(len, 1 + rand() % 8);
+		check("periodic", len);
+	}
+
+	/* Long literal runs and matches need length continuations. */
+	for (int i = 0; i < 200; ++i) {
+		size_t len = MF_LIMIT + 1 + rand() % 4096;
+
+		fillRandom(len);
+		check("random", len);
+
+		fillPeriodic(len, 1 + rand() % 300);
+		check("periodic", len);
+
+		fillCommands(len);
+		check("commands", len);
+	}
+
+	/* Repeats at and just beyond the furthest a match offset can reach */
+	fillDistant(INPUT_MAX, 65535);
+	check("furthest repeat", INPUT_MAX);
+
+	fillDistant(INPUT_MAX, 65536);
+	check("unreachable repeat", INPUT_MAX);
+
+	/* Repetitive input has to come out smaller, or nothing is matched. */
+	memset(input, 0, 4096);
+	size_t zerosSz = igniCompress(input, 4096, block, sizeof(block));
+
+	if (!zerosSz || zerosSz > 64) {
+		printf("FAIL zeros: 4096 bytes compressed to %zu\n", zerosSz);
+		++failures;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,663 @@
+#include "render.h"
+#include "hit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Every encoded command and event must be sized correctly by its table,
+ * both when it is complete and when only a prefix of it has arrived. A
+ * reader that keeps reading up to the size reported so far has to end up
+ * with exactly the encoded bytes. */
+
+typedef size_t (*SizeFn)(const void* buf, size_t len);
+
+static int failures;
+
+static void check(const char* name, SizeFn sizeFn, const void* buf, size_t sz)
+{
+	if (sizeFn(buf, 0) != 0) {
+		printf("FAIL %s: nonzero size of empty buffer\n", name);
+		++failures;
+	}
+
+	if (sizeFn(buf, sz) != sz) {
+		printf(
+			"FAIL %s: size %zu, encoded %zu\n",
+			name,
+			sizeFn(buf, sz),
+			sz
+		);
+		++failures;
+		return;
+	}
+
+	for (size_t len = 1; len < sz; ++len) {
+		size_t partSz = sizeFn(buf, len);
+
+		if (partSz <= len || partSz > sz) {
+			printf(
+				"FAIL %s: size %zu from %zu of %zu bytes\n",
+				name,
+				partSz,
+				len,
+				sz
+			);
+			++failures;
+			return;
+		}
+	}
+
+	size_t have = 1;
+	size_t needed;
+
+	while ((needed = sizeFn(buf, have)) > have) {
+		have = needed;
+	}
+
+	if (have != sz) {
+		printf("FAIL %s: read %zu of %zu bytes\n", name, have, sz);
+		++failures;
+	}
+}
+
+static void checkRender(void)
+{
+	static uint8_t buf[4096];
+	static const char path[] = "/usr/share/igni/mesh.obj";
+	IgniTransform tf = {};
+	IgniViewTransform view = {};
+	IgniVec3 vec = {};
+
+	check("render configure", igniRndCmdSz, buf,
+		igniRndEncodeConfigure(buf, IGNI_RENDER_VERSION));
+	check("render mesh create", igniRndCmdSz, buf,
+		igniRndEncodeMeshCreate(buf, 1, path, sizeof(path) - 1));
+	check("render mesh create, empty path", igniRndCmdSz, buf,
+		igniRndEncodeMeshCreate(buf, 1, path, 0));
+	check("render mesh set shader", igniRndCmdSz, buf,
+		igniRndEncodeMeshSetShader(buf, 1, 0));
+	check("render mesh bind texture", igniRndCmdSz, buf,
+		igniRndEncodeMeshBindTexture(buf, 1, 2, 0));
+	check("render mesh transform", igniRndCmdSz, buf,
+		igniRndEncodeMeshTransform(buf, 1, tf));
+	check("render mesh delete", igniRndCmdSz, buf,
+		igniRndEncodeMeshDelete(buf, 1));
+	check("render point light create", igniRndCmdSz, buf,
+		igniRndEncodePointLightCreate(buf, 1));
+	check("render point light transform", igniRndCmdSz, buf,
+		igniRndEncodePointLightTransform(buf, 1, vec));
+	check("render point light set colour", igniRndCmdSz, buf,
+		igniRndEncodePointLightSetColour(buf, 1, vec));
+	check("render point light delete", igniRndCmdSz, buf,
+		igniRndEncodePointLightDelete(buf, 1));
+	check("render texture create", igniRndCmdSz, buf,
+		igniRndEncodeTextureCreate(buf, 1, path, sizeof(path) - 1));
+	check("render texture delete", igniRndCmdSz, buf,
+		igniRndEncodeTextureDelete(buf, 1));
+	check("render viewpoint transform", igniRndCmdSz, buf,
+		igniRndEncodeViewpointTransform(buf, view, 90.0f));
+	check("render bundle load", igniRndCmdSz, buf,
+		igniRndEncodeBundleLoad(buf, path, sizeof(path) - 1));
+	check("render texture stream create", igniRndCmdSz, buf,
+		igniRndEncodeTextureStreamCreate(
+			buf,
+			1,
+			64,
+			64,
+			IGNI_RENDER_TEXTURE_FORMAT_RGBA8,
+			7
+		));
+
+	static uint8_t pixels[16 * 16 * 4];
+	size_t levelSz = igniRndTextureLevelSz(
+		64,
+		64,
+		IGNI_RENDER_TEXTURE_FORMAT_RGBA8,
+		2
+	);
+
+	check("render texture stream level", igniRndCmdSz, buf,
+		igniRndEncodeTextureStreamLevel(buf, 1, 2, pixels, levelSz));
+	check("render texture stream priority", igniRndCmdSz, buf,
+		igniRndEncodeTextureStreamPriority(buf, 1, 0.5f));
+	check("render texture stream cancel", igniRndCmdSz, buf,
+		igniRndEncodeTextureStreamCancel(buf, 1));
+	check("render element set parent", igniRndCmdSz, buf,
+		igniRndEncodeElementSetParent(buf, 0, 1, 0, 2));
+	check("render mesh instance create", igniRndCmdSz, buf,
+		igniRndEncodeMeshInstanceCreate(buf, 2, 1));
+
+	IgniTransform tfs[5] = {};
+	check("render mesh transform batch", igniRndCmdSz, buf,
+		igniRndEncodeMeshTransformBatch(buf, 1, tfs, 5));
+	check("render mesh transform batch, empty", igniRndCmdSz, buf,
+		igniRndEncodeMeshTransformBatch(buf, 1, tfs, 0));
+
+	memset(buf, 0, sizeof(buf));
+	check("render compressed", igniRndCmdSz, buf,
+		igniRndEncodeCompressed(buf, 300, 100));
+
+	buf[0] = 0x80;
+	if (igniRndCmdSz(buf, 1) || igniRndCmdSz(buf, sizeof(buf))) {
+		printf("FAIL render: unknown opcode is sized\n");
+		++failures;
+	}
+}
+
+static void checkHit(void)
+{
+	static uint8_t buf[4096];
+	IgniTransform tf = {};
+	IgniVec3 vec = {};
+
+	check("hit configure", igniHitCmdSz, buf,
+		igniHitEncodeConfigure(buf, IGNI_HIT_VERSION));
+	check("hit hitbox create", igniHitCmdSz, buf,
+		igniHitEncodeHitboxCreate(buf, 1));
+	check("hit hitbox transform", igniHitCmdSz, buf,
+		igniHitEncodeHitboxTransform(buf, 1, tf));
+	check("hit hitbox delete", igniHitCmdSz, buf,
+		igniHitEncodeHitboxDelete(buf, 1));
+	check("hit query raycast", igniHitCmdSz, buf,
+		igniHitEncodeQueryRaycast(buf, 1, vec, vec, 10.0f, 4));
+	check("hit query overlap box", igniHitCmdSz, buf,
+		igniHitEncodeQueryOverlapBox(buf, 1, tf, 4));
+	check("hit query closest", igniHitCmdSz, buf,
+		igniHitEncodeQueryClosest(buf, 1, vec, 10.0f));
+	check("hit hitbox set filter", igniHitCmdSz, buf,
+		igniHitEncodeHitboxSetFilter(buf, 1, 1, 1));
+	check("hit hitbox set parent", igniHitCmdSz, buf,
+		igniHitEncodeHitboxSetParent(buf, 1, 2));
+	check("hit hitbox create shaped", igniHitCmdSz, buf,
+		igniHitEncodeHitboxCreateShaped(buf, 1, 0));
+	check("hit hitbox transform sphere", igniHitCmdSz, buf,
+		igniHitEncodeHitboxTransformSphere(buf, 1, vec, 1.0f));
+	check("hit hitbox transform capsule", igniHitCmdSz, buf,
+		igniHitEncodeHitboxTransformCapsule(buf, 1, vec, vec, 1.0f));
+
+	memset(buf, 0, sizeof(buf));
+	check("hit compressed", igniHitCmdSz, buf,
+		igniHitEncodeCompressed(buf, 300, 100));
+
+	buf[0] = 0x80;
+	if (igniHitCmdSz(buf, 1) || igniHitCmdSz(buf, sizeof(buf))) {
+		printf("FAIL hit: unknown opcode is sized\n");
+		++failures;
+	}
+}
+
+static void checkHitEvents(void)
+{
+	static uint8_t buf[
+		IGNI_HIT_QUERY_RESULTS_SZ + 3 * sizeof(IgniHitQueryResult)
+	];
+
+	IgniHitEventHitboxTrigger trigger = { 1 };
+	buf[0] = IGNI_HIT_EVENT_HITBOX_TRIGGER;
+	memcpy(buf + sizeof(IgniHitEvent), &trigger, sizeof(trigger));
+	check("hit event hitbox trigger", igniHitEventSz, buf,
+		IGNI_HIT_HITBOX_TRIGGER_SZ);
+
+	IgniHitEventHitboxRelease release = { 1 };
+	buf[0] = IGNI_HIT_EVENT_HITBOX_RELEASE;
+	memcpy(buf + sizeof(IgniHitEvent), &release, sizeof(release));
+	check("hit event hitbox release", igniHitEventSz, buf,
+		IGNI_HIT_HITBOX_RELEASE_SZ);
+
+	for (uint16_t count = 0; count <= 3; ++count) {
+		IgniHitEventQueryResults results = { count };
+		buf[0] = IGNI_HIT_EVENT_QUERY_RESULTS;
+		memcpy(buf + sizeof(IgniHitEvent), &results, sizeof(results));
+		check("hit event query results", igniHitEventSz, buf,
+			IGNI_HIT_QUERY_RESULTS_SZ + count * sizeof(IgniHitQueryResult));
+	}
+
+	buf[0] = IGNI_HIT_EVENT_NUL;
+	if (igniHitEventSz(buf, 1) || igniHitEventSz(buf, sizeof(buf))) {
+		printf("FAIL hit event: unknown event is sized\n");
+		++failures;
+	}
+}
+
+/* Random round trips. Every number a table knows is encoded from random
+ * fields, with a random element count if it has a tail. A stream of such
+ * encodings is then read back in random pieces, split by its table alone,
+ * and each piece must decode to exactly the fields it was encoded from.
+ *
+ * None of the commands has reserved bytes, so the fields are drawn as a
+ * random image of the whole command and decoded by copying them out. */
+
+#define FUZZ_ROUNDS 200
+#define FUZZ_EXTRA 32
+#define FUZZ_TAIL_MAX 1024
+#define FUZZ_CMD_MAX (64 + FUZZ_TAIL_MAX)
+
+/* Encode the command of a random image through the library, from the
+ * fields decoded out of the image. Returns 0 if there is no encoder. */
+typedef size_t (*EncodeFn)(uint8_t* buf, const uint8_t* want);
+
+#define DECODE(type, name) \
+	type name; \
+	memcpy(&name, want + 1, sizeof(name))
+
+static unsigned seed;
+
+static void randomBytes(uint8_t* buf, size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		buf[i] = rand();
+	}
+}
+
+static IgniVec3 vec(float x, float y, float z)
+{
+	IgniVec3 v;
+	v.x = x;
+	v.y = y;
+	v.z = z;
+
+	return v;
+}
+
+static IgniTransform transform(IgniVec3 loc, IgniVec3 rot, IgniVec3 scale)
+{
+	IgniTransform tf;
+	tf.location = loc;
+	tf.rotation = rot;
+	tf.scale = scale;
+
+	return tf;
+}
+
+static size_t encodeRender(uint8_t* buf, const uint8_t* want)
+{
+	switch (want[0]) {
+	case IGNI_RENDER_OP_CONFIGURE: {
+		DECODE(IgniRndCmdConfigure, c);
+		return igniRndEncodeConfigure(buf, c.majVersion);
+	}
+	case IGNI_RENDER_OP_MESH_CREATE: {
+		DECODE(IgniRndCmdMeshCreate, c);
+		return igniRndEncodeMeshCreate(buf, c.meshId,
+			(const char*)want + IGNI_RENDER_MESH_CREATE_SZ, c.pathLen);
+	}
+	case IGNI_RENDER_OP_MESH_SET_SHADER: {
+		DECODE(IgniRndCmdMeshSetShader, c);
+		return igniRndEncodeMeshSetShader(buf, c.meshId, c.shader);
+	}
+	case IGNI_RENDER_OP_MESH_BIND_TEXTURE: {
+		DECODE(IgniRndCmdMeshBindTexture, c);
+		return igniRndEncodeMeshBindTexture(buf, c.meshId, c.textureId,
+			c.target);
+	}
+	case IGNI_RENDER_OP_MESH_TRANSFORM: {
+		DECODE(IgniRndCmdMeshTransform, c);
+		return igniRndEncodeMeshTransform(buf, c.meshId, transform(
+			vec(c.xLoc, c.yLoc, c.zLoc),
+			vec(c.xRot, c.yRot, c.zRot),
+			vec(c.xScale, c.yScale, c.zScale)
+		));
+	}
+	case IGNI_RENDER_OP_MESH_DELETE: {
+		DECODE(IgniRndCmdMeshDelete, c);
+		return igniRndEncodeMeshDelete(buf, c.meshId);
+	}
+	case IGNI_RENDER_OP_POINT_LIGHT_CREATE: {
+		DECODE(IgniRndCmdPointLightCreate, c);
+		return igniRndEncodePointLightCreate(buf, c.pointLightId);
+	}
+	case IGNI_RENDER_OP_POINT_LIGHT_TRANSFORM: {
+		DECODE(IgniRndCmdPointLightTransform, c);
+		return igniRndEncodePointLightTransform(buf, c.pointLightId,
+			vec(c.xLoc, c.yLoc, c.zLoc));
+	}
+	case IGNI_RENDER_OP_POINT_LIGHT_SET_COLOUR: {
+		DECODE(IgniRndCmdPointLightSetColour, c);
+		return igniRndEncodePointLightSetColour(buf, c.pointLightId,
+			vec(c.r, c.g, c.b));
+	}
+	case IGNI_RENDER_OP_POINT_LIGHT_DELETE: {
+		DECODE(IgniRndCmdPointLightDelete, c);
+		return igniRndEncodePointLightDelete(buf, c.pointLightId);
+	}
+	case IGNI_RENDER_OP_TEXTURE_CREATE: {
+		DECODE(IgniRndCmdTextureCreate, c);
+		return igniRndEncodeTextureCreate(buf, c.textureId,
+			(const char*)want + IGNI_RENDER_TEXTURE_CREATE_SZ, c.pathLen);
+	}
+	case IGNI_RENDER_OP_TEXTURE_DELETE: {
+		DECODE(IgniRndCmdTextureDelete, c);
+		return igniRndEncodeTextureDelete(buf, c.textureId);
+	}
+	case IGNI_RENDER_OP_VIEWPOINT_TRANSFORM: {
+		DECODE(IgniRndCmdViewpointTransform, c);
+		IgniViewTransform view;
+		view.location = vec(c.xLoc, c.yLoc, c.zLoc);
+		view.lookAt = vec(c.xLook, c.yLook, c.zLook);
+		return igniRndEncodeViewpointTransform(buf, view, c.fov);
+	}
+	case IGNI_RENDER_OP_BUNDLE_LOAD: {
+		DECODE(IgniRndCmdBundleLoad, c);
+		return igniRndEncodeBundleLoad(buf,
+			(const char*)want + IGNI_RENDER_BUNDLE_LOAD_SZ, c.pathLen);
+	}
+	case IGNI_RENDER_OP_TEXTURE_STREAM_CREATE: {
+		DECODE(IgniRndCmdTextureStreamCreate, c);
+		return igniRndEncodeTextureStreamCreate(buf, c.textureId, c.width,
+			c.height, c.format, c.levelCount);
+	}
+	case IGNI_RENDER_OP_TEXTURE_STREAM_LEVEL: {
+		DECODE(IgniRndCmdTextureStreamLevel, c);
+		return igniRndEncodeTextureStreamLevel(buf, c.textureId, c.level,
+			want + IGNI_RENDER_TEXTURE_STREAM_LEVEL_SZ, c.dataLen);
+	}
+	case IGNI_RENDER_OP_TEXTURE_STREAM_PRIORITY: {
+		DECODE(IgniRndCmdTextureStreamPriority, c);
+		return igniRndEncodeTextureStreamPriority(buf, c.textureId,
+			c.priority);
+	}
+	case IGNI_RENDER_OP_TEXTURE_STREAM_CANCEL: {
+		DECODE(IgniRndCmdTextureStreamCancel, c);
+		return igniRndEncodeTextureStreamCancel(buf, c.textureId);
+	}
+	case IGNI_RENDER_OP_ELEMENT_SET_PARENT: {
+		DECODE(IgniRndCmdElementSetParent, c);
+		return igniRndEncodeElementSetParent(buf, c.childType, c.childId,
+			c.parentType, c.parentId);
+	}
+	case IGNI_RENDER_OP_MESH_INSTANCE_CREATE: {
+		DECODE(IgniRndCmdMeshInstanceCreate, c);
+		return igniRndEncodeMeshInstanceCreate(buf, c.meshId,
+			c.sourceMeshId);
+	}
+	case IGNI_RENDER_OP_MESH_TRANSFORM_BATCH: {
+		DECODE(IgniRndCmdMeshTransformBatch, c);
+		return igniRndEncodeMeshTransformBatch(buf, c.firstMeshId,
+			(const IgniTransform*)(want + IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ),
+			c.count);
+	}
+	case IGNI_RENDER_OP_COMPRESSED: {
+		/* The block itself is written by the caller. */
+		DECODE(IgniRndCmdCompressed, c);
+		memcpy(buf + IGNI_RENDER_COMPRESSED_SZ,
+			want + IGNI_RENDER_COMPRESSED_SZ, c.dataLen);
+		return igniRndEncodeCompressed(buf, c.rawLen, c.dataLen);
+	}
+	}
+
+	return 0;
+}
+
+static size_t encodeHit(uint8_t* buf, const uint8_t* want)
+{
+	switch (want[0]) {
+	case IGNI_HIT_OP_CONFIGURE: {
+		DECODE(IgniHitCmdConfigure, c);
+		return igniHitEncodeConfigure(buf, c.majVersion);
+	}
+	case IGNI_HIT_OP_HITBOX_CREATE: {
+		DECODE(IgniHitCmdHitboxCreate, c);
+		return igniHitEncodeHitboxCreate(buf, c.hitboxId);
+	}
+	case IGNI_HIT_OP_HITBOX_TRANSFORM: {
+		DECODE(IgniHitCmdHitboxTransform, c);
+		return igniHitEncodeHitboxTransform(buf, c.hitboxId, transform(
+			vec(c.xLoc, c.yLoc, c.zLoc),
+			vec(c.xRot, c.yRot, c.zRot),
+			vec(c.width, c.height, c.depth)
+		));
+	}
+	case IGNI_HIT_OP_HITBOX_DELETE: {
+		DECODE(IgniHitCmdHitboxDelete, c);
+		return igniHitEncodeHitboxDelete(buf, c.hitboxId);
+	}
+	case IGNI_HIT_OP_QUERY_RAYCAST: {
+		DECODE(IgniHitCmdQueryRaycast, c);
+		return igniHitEncodeQueryRaycast(buf, c.requestId,
+			vec(c.xOrigin, c.yOrigin, c.zOrigin),
+			vec(c.xDir, c.yDir, c.zDir), c.maxDistance, c.maxHits);
+	}
+	case IGNI_HIT_OP_QUERY_OVERLAP_BOX: {
+		DECODE(IgniHitCmdQueryOverlapBox, c);
+		return igniHitEncodeQueryOverlapBox(buf, c.requestId, transform(
+			vec(c.xLoc, c.yLoc, c.zLoc),
+			vec(c.xRot, c.yRot, c.zRot),
+			vec(c.width, c.height, c.depth)
+		), c.maxHits);
+	}
+	case IGNI_HIT_OP_QUERY_CLOSEST: {
+		DECODE(IgniHitCmdQueryClosest, c);
+		return igniHitEncodeQueryClosest(buf, c.requestId,
+			vec(c.xLoc, c.yLoc, c.zLoc), c.maxDistance);
+	}
+	case IGNI_HIT_OP_HITBOX_SET_FILTER: {
+		DECODE(IgniHitCmdHitboxSetFilter, c);
+		return igniHitEncodeHitboxSetFilter(buf, c.hitboxId, c.layers,
+			c.mask);
+	}
+	case IGNI_HIT_OP_HITBOX_SET_PARENT: {
+		DECODE(IgniHitCmdHitboxSetParent, c);
+		return igniHitEncodeHitboxSetParent(buf, c.hitboxId, c.parentId);
+	}
+	case IGNI_HIT_OP_HITBOX_CREATE_SHAPED: {
+		DECODE(IgniHitCmdHitboxCreateShaped, c);
+		return igniHitEncodeHitboxCreateShaped(buf, c.hitboxId, c.shape);
+	}
+	case IGNI_HIT_OP_HITBOX_TRANSFORM_SPHERE: {
+		DECODE(IgniHitCmdHitboxTransformSphere, c);
+		return igniHitEncodeHitboxTransformSphere(buf, c.hitboxId,
+			vec(c.xLoc, c.yLoc, c.zLoc), c.radius);
+	}
+	case IGNI_HIT_OP_HITBOX_TRANSFORM_CAPSULE: {
+		DECODE(IgniHitCmdHitboxTransformCapsule, c);
+		return igniHitEncodeHitboxTransformCapsule(buf, c.hitboxId,
+			vec(c.xA, c.yA, c.zA), vec(c.xB, c.yB, c.zB), c.radius);
+	}
+	case IGNI_HIT_OP_COMPRESSED: {
+		DECODE(IgniHitCmdCompressed, c);
+		memcpy(buf + IGNI_HIT_COMPRESSED_SZ,
+			want + IGNI_HIT_COMPRESSED_SZ, c.dataLen);
+		return igniHitEncodeCompressed(buf, c.rawLen, c.dataLen);
+	}
+	}
+
+	return 0;
+}
+
+/* Events are encoded by servers, so they are built field by field here. */
+static size_t encodeHitEvent(uint8_t* buf, const uint8_t* want)
+{
+	switch (want[0]) {
+	case IGNI_HIT_EVENT_HITBOX_TRIGGER: {
+		DECODE(IgniHitEventHitboxTrigger, c);
+		buf[0] = IGNI_HIT_EVENT_HITBOX_TRIGGER;
+		memcpy(buf + sizeof(IgniHitEvent), &c, sizeof(c));
+		return IGNI_HIT_HITBOX_TRIGGER_SZ;
+	}
+	case IGNI_HIT_EVENT_HITBOX_RELEASE: {
+		DECODE(IgniHitEventHitboxRelease, c);
+		buf[0] = IGNI_HIT_EVENT_HITBOX_RELEASE;
+		memcpy(buf + sizeof(IgniHitEvent), &c, sizeof(c));
+		return IGNI_HIT_HITBOX_RELEASE_SZ;
+	}
+	case IGNI_HIT_EVENT_QUERY_RESULTS: {
+		DECODE(IgniHitEventQueryResults, c);
+		size_t resultsSz = c.resultCount * sizeof(IgniHitQueryResult);
+		buf[0] = IGNI_HIT_EVENT_QUERY_RESULTS;
+		memcpy(buf + sizeof(IgniHitEvent), &c, sizeof(c));
+		memcpy(buf + IGNI_HIT_QUERY_RESULTS_SZ,
+			want + IGNI_HIT_QUERY_RESULTS_SZ, resultsSz);
+		return IGNI_HIT_QUERY_RESULTS_SZ + resultsSz;
+	}
+	}
+
+	return 0;
+}
+
+/* Draw a random image of a command, with a tail of random length. */
+static size_t randomCommand(
+	const IgniOpcodeDesc* descs,
+	uint8_t opcode,
+	uint8_t* want
+)
+{
+	const IgniOpcodeDesc* desc = &descs[opcode];
+
+	want[0] = opcode;
+	randomBytes(want + 1, desc->fixedSz - 1);
+
+	if (!desc->countSz) {
+		return desc->fixedSz;
+	}
+
+	uint32_t maxCount = FUZZ_TAIL_MAX / desc->elemSz;
+	if (desc->countSz == 1 && maxCount > UINT8_MAX) {
+		maxCount = UINT8_MAX;
+	}
+
+	/* Empty and full tails are drawn more often than chance would. */
+	uint32_t count;
+
+	switch (rand() % 4) {
+	case 0:
+		count = 0;
+		break;
+	case 1:
+		count = maxCount;
+		break;
+	default:
+		count = rand() % (maxCount + 1);
+	}
+
+	memcpy(want + desc->countOffset, &count, desc->countSz);
+	randomBytes(want + desc->fixedSz, (size_t)count * desc->elemSz);
+
+	return desc->fixedSz + (size_t)count * desc->elemSz;
+}
+
+static void fuzz(
+	const char* name,
+	const IgniOpcodeDesc* descs,
+	SizeFn sizeFn,
+	EncodeFn encode
+)
+{
+	static uint8_t stream[(256 + FUZZ_EXTRA) * FUZZ_CMD_MAX];
+	static uint8_t wants[(256 + FUZZ_EXTRA) * FUZZ_CMD_MAX];
+	static size_t wantSzs[256 + FUZZ_EXTRA];
+
+	uint8_t opcodes[256];
+	size_t opcodeCount = 0;
+
+	for (int i = 0; i < 256; ++i) {
+		if (descs[i].fixedSz) {
+			opcodes[opcodeCount++] = i;
+		}
+	}
+
+	for (int round = 0; round < FUZZ_ROUNDS; ++round) {
+		/* Each stream holds every number once, and then some. */
+		size_t cmdCount = opcodeCount + rand() % (FUZZ_EXTRA + 1);
+		size_t streamSz = 0;
+
+		for (size_t i = 0; i < cmdCount; ++i) {
+			uint8_t opcode = i < opcodeCount ?
+				opcodes[i] :
+				opcodes[rand() % opcodeCount];
+
+			uint8_t* want = wants + i * FUZZ_CMD_MAX;
+			wantSzs[i] = randomCommand(descs, opcode, want);
+
+			size_t sz = encode(stream + streamSz, want);
+
+			if (sz != wantSzs[i]) {
+				printf(
+					"FAIL %s fuzz: number %u encoded in %zu bytes, not %zu"
+					" (seed %u)\n",
+					name,
+					opcode,
+					sz,
+					wantSzs[i],
+					seed
+				);
+				++failures;
+				return;
+			}
+
+			streamSz += sz;
+		}
+
+		/* Read the stream as it might arrive from a socket. */
+		size_t have = 0;
+		size_t off = 0;
+
+		for (size_t i = 0; i < cmdCount; ) {
+			size_t sz = sizeFn(stream + off, have - off);
+
+			if (off == have || sz > have - off) {
+				if (have == streamSz) {
+					printf(
+						"FAIL %s fuzz: number %u sized %zu at the end of the"
+						" stream (seed %u)\n",
+						name,
+						stream[off],
+						sz,
+						seed
+					);
+					++failures;
+					return;
+				}
+
+				have += 1 + rand() % (rand() % 2 ? 16 : FUZZ_CMD_MAX);
+				if (have > streamSz) {
+					have = streamSz;
+				}
+				continue;
+			}
+
+			const uint8_t* want = wants + i * FUZZ_CMD_MAX;
+
+			if (sz != wantSzs[i] || memcmp(stream + off, want, sz)) {
+				printf(
+					"FAIL %s fuzz: number %u read back as %zu bytes of"
+					" number %u, not %zu (seed %u)\n",
+					name,
+					want[0],
+					sz,
+					stream[off],
+					wantSzs[i],
+					seed
+				);
+				++failures;
+				return;
+			}
+
+			off += sz;
+			++i;
+		}
+
+		if (off != streamSz) {
+			printf("FAIL %s fuzz: %zu bytes left over (seed %u)\n",
+				name, streamSz - off, seed);
+			++failures;
+			return;
+		}
+	}
+}
+
+int main(void)
+{
+	checkRender();
+	checkHit();
+	checkHitEvents();
+
+	seed = time(NULL);
+	srand(seed);
+
+	fuzz("render", igniRndOpcodes, igniRndCmdSz, encodeRender);
+	fuzz("hit", igniHitOpcodes, igniHitCmdSz, encodeHit);
+	fuzz("hit event", igniHitEvents, igniHitEventSz, encodeHitEvent);
+
+	return failures ? 1 : 0;
+}
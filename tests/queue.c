@@ -0,0 +1,370 @@
+#include "render.h"
+#include "conn.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* Commands sent through a non-blocking connection must reach the server
+ * whole and in order, however the outbound queue is filled, merged into
+ * and drained. The server end is left unread until a test drains it, so
+ * that commands pile up in the queue. */
+
+#define FILLER_ID 1000
+
+typedef struct {
+	uint8_t opcode;
+	uint32_t id;
+	float x;
+} Cmd;
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+	if (!(cond)) { \
+		printf("FAIL %s: ", __func__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		++failures; \
+	} \
+} while (0)
+
+/* Open a render connection to a server socket of our own. */
+static int openConn(int* srv, size_t queueSz, IgniConnFlags flags)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/igni-queue-%d", (int)getpid());
+	unlink(path);
+
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (
+		listener == -1 ||
+		bind(listener, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+		listen(listener, 1) == -1
+	) {
+		perror("Test server setup failed");
+		return -1;
+	}
+
+	int fd = igniRndOpenAt(path);
+	*srv = accept(listener, NULL, NULL);
+
+	close(listener);
+	unlink(path);
+
+	if (fd == -1 || *srv == -1) {
+		return -1;
+	}
+
+	fcntl(*srv, F_SETFL, O_NONBLOCK);
+
+	if (igniConnSetNonBlocking(fd, queueSz, flags) == -1) {
+		return -1;
+	}
+
+	return fd;
+}
+
+/* Send deletions of unused meshes until the socket stops taking them. */
+static void fillSocket(int fd)
+{
+	for (uint32_t id = FILLER_ID; !igniConnPending(fd); ++id) {
+		if (igniRndMeshDelete(fd, id) == -1) {
+			break;
+		}
+	}
+}
+
+/* Read everything sent so far, flushing the queue as the socket drains. */
+static size_t drain(int fd, int srv, uint8_t* buf, size_t cap)
+{
+	size_t len = 0;
+
+	for (int idle = 0; idle < 100; ) {
+		igniConnFlush(fd);
+
+		ssize_t n = recv(srv, buf + len, cap - len, 0);
+
+		if (n > 0) {
+			len += n;
+			idle = 0;
+		} else if (igniConnPending(fd)) {
+			usleep(100);
+		} else {
+			++idle;
+		}
+	}
+
+	return len;
+}
+
+/* Decode received commands, leaving out configuration and filler. Returns
+ * the number of commands, or -1 if the stream is corrupt. */
+static int decode(const uint8_t* buf, size_t len, Cmd* cmds, int cap)
+{
+	int count = 0;
+
+	for (size_t off = 0; off < len; ) {
+		size_t cmdSz = igniRndCmdSz(buf + off, len - off);
+
+		if (!cmdSz || cmdSz > len - off || count == cap) {
+			return -1;
+		}
+
+		Cmd cmd = { buf[off], 0, 0 };
+
+		if (cmdSz >= 1 + sizeof(cmd.id)) {
+			memcpy(&cmd.id, buf + off + 1, sizeof(cmd.id));
+		}
+
+		if (cmd.opcode == IGNI_RENDER_OP_MESH_TRANSFORM) {
+			memcpy(&cmd.x, buf + off + IGNI_RENDER_MESH_TRANSFORM_SZ -
+				sizeof(IgniRndTransformRecord), sizeof(cmd.x));
+		} else if (cmd.opcode == IGNI_RENDER_OP_MESH_TRANSFORM_BATCH) {
+			memcpy(&cmd.x, buf + off + IGNI_RENDER_MESH_TRANSFORM_BATCH_SZ,
+				sizeof(cmd.x));
+		}
+
+		off += cmdSz;
+
+		int filler =
+			cmd.opcode == IGNI_RENDER_OP_MESH_DELETE && cmd.id >= FILLER_ID;
+
+		if (cmd.opcode != IGNI_RENDER_OP_CONFIGURE && !filler) {
+			cmds[count++] = cmd;
+		}
+	}
+
+	return count;
+}
+
+static IgniTransform transformAt(float x)
+{
+	IgniTransform tf = {};
+	tf.location.x = x;
+	return tf;
+}
+
+/* A transform must not be merged past a batch that covers its mesh. */
+static void testMergeBehindBatch(void)
+{
+	static uint8_t buf[1 << 20];
+	Cmd cmds[16];
+
+	int srv;
+	int fd = openConn(&srv, 1 << 16, IGNI_CONN_MERGE_TRANSFORMS);
+	CHECK(fd != -1, "connection setup failed");
+	if (fd == -1) {
+		return;
+	}
+
+	fillSocket(fd);
+
+	IgniTransform tfs[4] = {
+		transformAt(2), transformAt(2), transformAt(2), transformAt(2)
+	};
+
+	igniRndMeshTransform(fd, 7, transformAt(1));
+	igniRndMeshTransformBatch(fd, 5, tfs, 4);
+	igniRndMeshTransform(fd, 7, transformAt(3));
+
+	int count = decode(buf, drain(fd, srv, buf, sizeof(buf)), cmds, 16);
+
+	CHECK(count == 3, "received %d commands, expected 3", count);
+	if (count == 3) {
+		CHECK(
+			cmds[0].opcode == IGNI_RENDER_OP_MESH_TRANSFORM &&
+				cmds[0].x == 1 &&
+			cmds[1].opcode == IGNI_RENDER_OP_MESH_TRANSFORM_BATCH &&
+			cmds[2].opcode == IGNI_RENDER_OP_MESH_TRANSFORM &&
+				cmds[2].x == 3,
+			"commands reordered"
+		);
+	}
+
+	igniConnClose(fd);
+	close(srv);
+}
+
+/* Consecutive transforms of a mesh merge, but not across other commands
+ * for the same mesh. Commands for other meshes do not get in the way. */
+static void testMergeBarriers(void)
+{
+	static uint8_t buf[1 << 20];
+	Cmd cmds[16];
+
+	int srv;
+	int fd = openConn(&srv, 1 << 16, IGNI_CONN_MERGE_TRANSFORMS);
+	CHECK(fd != -1, "connection setup failed");
+	if (fd == -1) {
+		return;
+	}
+
+	fillSocket(fd);
+
+	igniRndMeshTransform(fd, 7, transformAt(1));
+	igniRndMeshDelete(fd, 7);
+	igniRndMeshCreate(fd, 7, "/dev/null");
+	igniRndMeshTransform(fd, 7, transformAt(2));
+	igniRndMeshDelete(fd, 8);
+	igniRndMeshTransform(fd, 7, transformAt(3));
+
+	int count = decode(buf, drain(fd, srv, buf, sizeof(buf)), cmds, 16);
+
+	CHECK(count == 5, "received %d commands, expected 5", count);
+	if (count == 5) {
+		CHECK(
+			cmds[0].opcode == IGNI_RENDER_OP_MESH_TRANSFORM &&
+				cmds[0].x == 1 &&
+			cmds[1].opcode == IGNI_RENDER_OP_MESH_DELETE &&
+				cmds[1].id == 7 &&
+			cmds[2].opcode == IGNI_RENDER_OP_MESH_CREATE &&
+			cmds[3].opcode == IGNI_RENDER_OP_MESH_TRANSFORM &&
+				cmds[3].x == 3 &&
+			cmds[4].opcode == IGNI_RENDER_OP_MESH_DELETE &&
+				cmds[4].id == 8,
+			"commands reordered or merged across a barrier"
+		);
+	}
+
+	igniConnClose(fd);
+	close(srv);
+}
+
+/* A command refused with EAGAIN leaves nothing behind, and is delivered
+ * exactly once when sent again after the queue drains. */
+static void testFullQueue(void)
+{
+	static uint8_t buf[1 << 20];
+	Cmd cmds[64];
+
+	int srv;
+	int fd = openConn(&srv, 256, 0);
+	CHECK(fd != -1, "connection setup failed");
+	if (fd == -1) {
+		return;
+	}
+
+	fillSocket(fd);
+
+	int queued = 0;
+
+	while (igniRndMeshTransform(fd, queued, transformAt(queued)) == 0) {
+		++queued;
+	}
+
+	CHECK(errno == EAGAIN, "full queue failed with %s", strerror(errno));
+
+	size_t pending = igniConnPending(fd);
+	int result = igniRndMeshTransform(fd, queued, transformAt(queued));
+
+	CHECK(result == -1, "full queue took another command");
+	CHECK(
+		igniConnPending(fd) == pending,
+		"refused command changed the queue from %zu to %zu bytes",
+		pending,
+		igniConnPending(fd)
+	);
+
+	size_t len = drain(fd, srv, buf, sizeof(buf));
+	igniRndMeshTransform(fd, queued, transformAt(queued));
+	len += drain(fd, srv, buf + len, sizeof(buf) - len);
+
+	int count = decode(buf, len, cmds, 64);
+
+	CHECK(
+		count == queued + 1,
+		"received %d commands, expected %d",
+		count,
+		queued + 1
+	);
+
+	for (int i = 0; i < count && i <= queued; ++i) {
+		CHECK(cmds[i].x == i, "command %d carries %g", i, cmds[i].x);
+	}
+
+	igniConnClose(fd);
+	close(srv);
+}
+
+/* Commands straddling the end of a small queue, which wraps over and over
+ * as the server reads at its own pace, arrive whole and in order. */
+static void testRingWrap(IgniConnFlags flags)
+{
+	enum { SENT = 2000 };
+
+	static uint8_t buf[4 << 20];
+	static Cmd cmds[SENT + 1];
+
+	int srv;
+	int fd = openConn(&srv, 256, flags);
+	CHECK(fd != -1, "connection setup failed");
+	if (fd == -1) {
+		return;
+	}
+
+	fillSocket(fd);
+
+	size_t len = 0;
+	int refused = 0;
+
+	for (int i = 0; i < SENT; ) {
+		if (igniRndMeshTransform(fd, i, transformAt(i)) == 0) {
+			++i;
+			continue;
+		}
+
+		CHECK(errno == EAGAIN, "send failed with %s", strerror(errno));
+		if (errno != EAGAIN) {
+			break;
+		}
+
+		++refused;
+
+		/* Read a little at a time, so that the queue only partly drains
+		 * and its head and tail go round at different offsets. */
+		ssize_t n = recv(srv, buf + len, 1 + refused % 97, 0);
+		if (n > 0) {
+			len += n;
+		}
+
+		igniConnFlush(fd);
+	}
+
+	CHECK(refused, "queue never filled");
+
+	len += drain(fd, srv, buf + len, sizeof(buf) - len);
+
+	int count = decode(buf, len, cmds, SENT + 1);
+
+	CHECK(count == SENT, "received %d commands, expected %d", count, SENT);
+
+	for (int i = 0; i < count; ++i) {
+		if (cmds[i].id != (uint32_t)i || cmds[i].x != i) {
+			CHECK(0, "command %d arrived as mesh %u at %g", i, cmds[i].id,
+				cmds[i].x);
+			break;
+		}
+	}
+
+	igniConnClose(fd);
+	close(srv);
+}
+
+int main(void)
+{
+	testMergeBehindBatch();
+	testMergeBarriers();
+	testFullQueue();
+	testRingWrap(0);
+	testRingWrap(IGNI_CONN_IO_URING);
+
+	return failures ? 1 : 0;
+}